@@ -0,0 +1,634 @@
+#include "BibleBooks.h"
+#include <algorithm>
+#include <array>
+
+namespace Bible {
+namespace {
+struct BookAlias {
+  // Folded (see foldName): lower case ASCII, no dots, single spaces and no
+  // space after a leading number ("1samuel", "mambo ya walawi")
+  const char *key;
+  int book; // Canonical number
+};
+
+// Every name and abbreviation the resolver knows, in English and Swahili. A
+// key may appear only once (checked at compile time); numberless names such
+// as "samuel" or "peter" deliberately mean the first book.
+constexpr BookAlias kBookAliases[] = {
+    // Genesis
+    {"gen", 1}, {"genesis", 1}, {"mwanzo", 1}, {"mwan", 1},
+    // Exodus
+    {"exo", 2}, {"exodus", 2}, {"kutoka", 2}, {"kut", 2},
+    // Leviticus
+    {"lev", 3}, {"leviticus", 3}, {"walawi", 3}, {"mambo ya walawi", 3},
+    {"wal", 3},
+    // Numbers
+    {"num", 4}, {"numbers", 4}, {"hesabu", 4}, {"hes", 4},
+    // Deuteronomy
+    {"deu", 5}, {"deuteronomy", 5}, {"kumbukumbu", 5}, {"kum", 5},
+    {"kumbukumbu la torati", 5},
+    // Joshua
+    {"jos", 6}, {"joshua", 6}, {"yoshua", 6}, {"yos", 6},
+    // Judges
+    {"jdg", 7}, {"judges", 7}, {"waamuzi", 7}, {"waa", 7},
+    // Ruth
+    {"rut", 8}, {"ruth", 8}, {"rutu", 8}, {"ruthu", 8},
+    // 1 Samuel
+    {"1sa", 9}, {"1samuel", 9}, {"sam", 9}, {"samuel", 9}, {"1sam", 9},
+    {"1samweli", 9}, {"1samueli", 9},
+    // 2 Samuel
+    {"2sa", 10}, {"2samuel", 10}, {"2sam", 10}, {"2samweli", 10},
+    {"2samueli", 10},
+    // 1 Kings
+    {"1ki", 11}, {"1kings", 11}, {"kin", 11}, {"kings", 11}, {"1wafalme", 11},
+    {"1waf", 11},
+    // 2 Kings
+    {"2ki", 12}, {"2kings", 12}, {"2wafalme", 12}, {"2waf", 12},
+    // 1 Chronicles
+    {"1ch", 13}, {"1chronicles", 13}, {"chr", 13}, {"chronicles", 13},
+    {"1chron", 13}, {"1mambo ya nyakati", 13}, {"1mambo", 13},
+    // 2 Chronicles
+    {"2ch", 14}, {"2chronicles", 14}, {"2chron", 14}, {"2mambo ya nyakati", 14},
+    {"2mambo", 14},
+    // Ezra
+    {"ezr", 15}, {"ezra", 15},
+    // Nehemiah
+    {"neh", 16}, {"nehemiah", 16}, {"nehemia", 16},
+    // Esther
+    {"est", 17}, {"esther", 17}, {"esta", 17},
+    // Job
+    {"job", 18}, {"ayubu", 18}, {"ayu", 18},
+    // Psalms
+    {"ps", 19}, {"psa", 19}, {"psalm", 19}, {"psalms", 19}, {"zaburi", 19},
+    {"zab", 19},
+    // Proverbs
+    {"pro", 20}, {"proverbs", 20}, {"mithali", 20}, {"mit", 20},
+    // Ecclesiastes
+    {"ecc", 21}, {"ecclesiastes", 21}, {"mhubiri", 21}, {"mhu", 21},
+    // Song of Solomon
+    {"son", 22}, {"song", 22}, {"wimbo ulio bora", 22}, {"wim", 22},
+    {"song of solomon", 22}, {"song of songs", 22},
+    // Isaiah
+    {"isa", 23}, {"isaiah", 23}, {"isaya", 23},
+    // Jeremiah
+    {"jer", 24}, {"jeremiah", 24}, {"yeremia", 24}, {"yer", 24},
+    // Lamentations
+    {"lam", 25}, {"lamentations", 25}, {"maombolezo", 25}, {"mao", 25},
+    // Ezekiel
+    {"eze", 26}, {"ezekiel", 26}, {"ezekieli", 26},
+    // Daniel
+    {"dan", 27}, {"daniel", 27}, {"danieli", 27},
+    // Hosea
+    {"hos", 28}, {"hosea", 28},
+    // Joel
+    {"joe", 29}, {"joel", 29}, {"yoeli", 29}, {"yoe", 29},
+    // Amos
+    {"amo", 30}, {"amos", 30}, {"amosi", 30},
+    // Obadiah
+    {"oba", 31}, {"obadiah", 31}, {"obadia", 31},
+    // Jonah
+    {"jon", 32}, {"jonah", 32}, {"yona", 32}, {"yon", 32},
+    // Micah
+    {"mic", 33}, {"micah", 33}, {"mika", 33}, {"mik", 33},
+    // Nahum
+    {"nah", 34}, {"nahum", 34}, {"nahumu", 34},
+    // Habakkuk
+    {"hab", 35}, {"habakkuk", 35}, {"habakuki", 35},
+    // Zephaniah
+    {"zep", 36}, {"zephaniah", 36}, {"sefania", 36}, {"sef", 36},
+    // Haggai
+    {"hag", 37}, {"haggai", 37}, {"hagai", 37},
+    // Zechariah
+    {"zec", 38}, {"zechariah", 38}, {"zakaria", 38}, {"zekaria", 38},
+    {"zak", 38},
+    // Malachi
+    {"mal", 39}, {"malachi", 39}, {"malaki", 39},
+    // Matthew
+    {"mat", 40}, {"matt", 40}, {"matthew", 40}, {"mathayo", 40},
+    // Mark
+    {"mar", 41}, {"mark", 41}, {"marko", 41},
+    // Luke
+    {"luk", 42}, {"luke", 42}, {"luka", 42},
+    // John
+    {"joh", 43}, {"john", 43}, {"jn", 43}, {"yohana", 43}, {"yoh", 43},
+    // Acts
+    {"act", 44}, {"acts", 44}, {"matendo", 44}, {"matendo ya mitume", 44},
+    {"mdo", 44},
+    // Romans
+    {"rom", 45}, {"romans", 45}, {"warumi", 45}, {"war", 45},
+    // 1 Corinthians
+    {"1co", 46}, {"1corinthians", 46}, {"cor", 46}, {"cori", 46},
+    {"corinthians", 46}, {"1cor", 46}, {"1wakorintho", 46}, {"1wak", 46},
+    // 2 Corinthians
+    {"2co", 47}, {"2corinthians", 47}, {"2cor", 47}, {"2wakorintho", 47},
+    {"2wak", 47},
+    // Galatians
+    {"gal", 48}, {"galatians", 48}, {"wagalatia", 48}, {"wag", 48},
+    // Ephesians
+    {"eph", 49}, {"ephesians", 49}, {"waefeso", 49}, {"waef", 49},
+    // Philippians
+    {"phi", 50}, {"philippians", 50}, {"wafilipi", 50}, {"waf", 50},
+    {"phil", 50},
+    // Colossians
+    {"col", 51}, {"colossians", 51}, {"wakolosai", 51}, {"wak", 51},
+    // 1 Thessalonians
+    {"1th", 52}, {"1thessalonians", 52}, {"thess", 52}, {"thessalonians", 52},
+    {"1thess", 52}, {"1wathesalonike", 52}, {"1wat", 52},
+    // 2 Thessalonians
+    {"2th", 53}, {"2thessalonians", 53}, {"2thess", 53}, {"2wathesalonike", 53},
+    {"2wat", 53},
+    // 1 Timothy
+    {"1ti", 54}, {"1timothy", 54}, {"tim", 54}, {"timothy", 54}, {"1tim", 54},
+    {"1timotheo", 54},
+    // 2 Timothy
+    {"2ti", 55}, {"2timothy", 55}, {"2tim", 55}, {"2timotheo", 55},
+    // Titus
+    {"tit", 56}, {"titus", 56}, {"tito", 56},
+    // Philemon
+    {"phm", 57}, {"philemon", 57}, {"filemoni", 57}, {"fil", 57}, {"phlm", 57},
+    // Hebrews
+    {"heb", 58}, {"hebrews", 58}, {"waebrania", 58}, {"wae", 58},
+    // James
+    {"jam", 59}, {"james", 59}, {"yakobo", 59}, {"yak", 59},
+    // 1 Peter
+    {"1pe", 60}, {"1peter", 60}, {"pet", 60}, {"peter", 60}, {"1pet", 60},
+    {"1petro", 60},
+    // 2 Peter
+    {"2pe", 61}, {"2peter", 61}, {"2pet", 61}, {"2petro", 61},
+    // 1 John
+    {"1jo", 62}, {"1jn", 62}, {"1john", 62}, {"1joh", 62},
+    {"1yohana", 62}, {"1yoh", 62},
+    // 2 John
+    {"2jo", 63}, {"2jn", 63}, {"2john", 63}, {"2joh", 63},
+    {"2yohana", 63}, {"2yoh", 63},
+    // 3 John
+    {"3jo", 64}, {"3jn", 64}, {"3john", 64}, {"3joh", 64},
+    {"3yohana", 64}, {"3yoh", 64},
+    // Jude
+    {"jud", 65}, {"jude", 65}, {"yuda", 65}, {"yud", 65},
+    // Revelation
+    {"rev", 66}, {"revelation", 66}, {"ufunuo", 66}, {"ufu", 66},
+    {"ufunuo wa yohana", 66},
+};
+
+constexpr int kAliasCount = int(sizeof(kBookAliases) / sizeof(kBookAliases[0]));
+
+constexpr int keyLength(const char *key) {
+  int length = 0;
+  while (key[length])
+    ++length;
+  return length;
+}
+
+constexpr int maxKeyLength() {
+  int longest = 0;
+  for (const BookAlias &alias : kBookAliases)
+    longest = std::max(longest, keyLength(alias.key));
+  return longest;
+}
+
+constexpr int kMaxKeyLength = maxKeyLength();
+
+constexpr bool isFolded(const char *key) {
+  bool numberOnly = true; // So far
+  for (int i = 0; key[i]; ++i) {
+    const char c = key[i];
+    if (c == ' ') {
+      if (i == 0 || numberOnly || key[i - 1] == ' ' || !key[i + 1])
+        return false;
+    } else if (!(c >= 'a' && c <= 'z') && !(c >= '0' && c <= '9')) {
+      return false;
+    }
+    numberOnly = numberOnly && c >= '0' && c <= '9';
+  }
+  return key[0] != 0;
+}
+
+constexpr bool aliasesAreValid() {
+  for (const BookAlias &alias : kBookAliases) {
+    if (!isFolded(alias.key) || alias.book < 1 ||
+        alias.book > kCanonicalBookCount)
+      return false;
+  }
+  return true;
+}
+
+static_assert(aliasesAreValid(), "Book aliases must be folded keys");
+
+// --- Exact names: perfect hash (hash and displace) ---
+//
+// A key's hash picks a bucket, and the bucket's displacement moves all of its
+// keys to free slots. Displacements are found at compile time, largest
+// buckets first, so a lookup is one hash and one string compare.
+
+constexpr int kHashBuckets = 256; // Powers of two
+constexpr int kHashSlots = 1024;
+static_assert(kHashSlots >= 2 * kAliasCount, "Hash table too full");
+
+constexpr quint32 hashKey(const char *key, int length) {
+  quint32 hash = 2166136261u; // FNV-1a
+  for (int i = 0; i < length; ++i) {
+    hash ^= quint8(key[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+constexpr int hashSlot(quint32 hash, quint32 displacement) {
+  hash += displacement * 0x9e3779b9u;
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+  return int(hash & (kHashSlots - 1));
+}
+
+struct AliasHash {
+  std::array<quint16, kHashBuckets> displacements{};
+  std::array<qint16, kHashSlots> entries{}; // Alias, -1 if free
+  bool complete = false;
+};
+
+constexpr AliasHash buildAliasHash() {
+  AliasHash table;
+  for (qint16 &slot : table.entries)
+    slot = -1;
+
+  // Aliases grouped by bucket
+  std::array<quint32, kAliasCount> hashes{};
+  std::array<int, kHashBuckets + 1> bucketStarts{};
+  for (int a = 0; a < kAliasCount; ++a) {
+    const char *key = kBookAliases[a].key;
+    hashes[a] = hashKey(key, keyLength(key));
+    ++bucketStarts[(hashes[a] & (kHashBuckets - 1)) + 1];
+  }
+  int largest = 0;
+  for (int b = 0; b < kHashBuckets; ++b) {
+    largest = std::max(largest, bucketStarts[b + 1]);
+    bucketStarts[b + 1] += bucketStarts[b];
+  }
+  std::array<int, kAliasCount> members{};
+  std::array<int, kHashBuckets> filled{};
+  for (int a = 0; a < kAliasCount; ++a) {
+    const int b = int(hashes[a] & (kHashBuckets - 1));
+    members[bucketStarts[b] + filled[b]++] = a;
+  }
+
+  for (int size = largest; size > 0; --size) {
+    for (int b = 0; b < kHashBuckets; ++b) {
+      if (bucketStarts[b + 1] - bucketStarts[b] != size)
+        continue;
+      bool placed = false;
+      for (quint32 d = 0; d <= 0xffff && !placed; ++d) {
+        int taken = 0;
+        while (taken < size) {
+          const int a = members[bucketStarts[b] + taken];
+          const int slot = hashSlot(hashes[a], d);
+          if (table.entries[slot] >= 0)
+            break;
+          table.entries[slot] = qint16(a);
+          ++taken;
+        }
+        placed = taken == size;
+        if (placed) {
+          table.displacements[b] = quint16(d);
+        } else {
+          // Undo this attempt
+          for (int i = 0; i < taken; ++i) {
+            const int a = members[bucketStarts[b] + i];
+            table.entries[hashSlot(hashes[a], d)] = -1;
+          }
+        }
+      }
+      if (!placed)
+        return table;
+    }
+  }
+  table.complete = true;
+  return table;
+}
+
+constexpr AliasHash kAliasHash = buildAliasHash();
+static_assert(kAliasHash.complete, "No perfect hash for the book aliases");
+
+// --- Prefixes: trie of the keys ---
+
+struct TrieNode {
+  char c = 0;
+  qint16 child = -1;   // First child
+  qint16 sibling = -1; // Next child of the parent
+  qint16 alias = -1;   // Key ending here
+};
+
+constexpr int trieCapacity() {
+  int nodes = 1;
+  for (const BookAlias &alias : kBookAliases)
+    nodes += keyLength(alias.key);
+  return nodes;
+}
+
+struct AliasTrie {
+  std::array<TrieNode, trieCapacity()> nodes{};
+  int size = 1; // Node 0 is the root
+  bool unique = true;
+};
+
+constexpr AliasTrie buildAliasTrie() {
+  AliasTrie trie;
+  for (int a = 0; a < kAliasCount; ++a) {
+    int node = 0;
+    for (const char *c = kBookAliases[a].key; *c; ++c) {
+      int child = trie.nodes[node].child;
+      while (child >= 0 && trie.nodes[child].c != *c)
+        child = trie.nodes[child].sibling;
+      if (child < 0) {
+        child = trie.size++;
+        trie.nodes[child].c = *c;
+        trie.nodes[child].sibling = trie.nodes[node].child;
+        trie.nodes[node].child = qint16(child);
+      }
+      node = child;
+    }
+    if (trie.nodes[node].alias >= 0)
+      trie.unique = false;
+    trie.nodes[node].alias = qint16(a);
+  }
+  return trie;
+}
+
+constexpr AliasTrie kAliasTrie = buildAliasTrie();
+static_assert(kAliasTrie.unique, "Duplicate key in the book aliases");
+
+// --- Running text: Aho-Corasick automaton over the trie ---
+//
+// A node's failure link is the node of the longest proper suffix of its path
+// that is also a path in the trie, where matching resumes when no child
+// takes the next character. Its output link is the nearest node on the
+// failure chain, itself included, where a key ends.
+
+constexpr int trieChild(const AliasTrie &trie, int node, char c) {
+  int child = trie.nodes[node].child;
+  while (child >= 0 && trie.nodes[child].c != c)
+    child = trie.nodes[child].sibling;
+  return child;
+}
+
+struct AliasAutomaton {
+  std::array<qint16, trieCapacity()> fail{};
+  std::array<qint16, trieCapacity()> output{};
+  std::array<qint8, trieCapacity()> depth{}; // Length of the node's path
+};
+
+constexpr AliasAutomaton buildAliasAutomaton() {
+  const AliasTrie &trie = kAliasTrie;
+  AliasAutomaton automaton;
+  automaton.output[0] = -1;
+  // Breadth first, so the failure chain of a node is done before its children
+  std::array<qint16, trieCapacity()> queue{};
+  int head = 0;
+  int tail = 0;
+  queue[tail++] = 0;
+  while (head < tail) {
+    const int node = queue[head++];
+    for (int child = trie.nodes[node].child; child >= 0;
+         child = trie.nodes[child].sibling) {
+      const char c = trie.nodes[child].c;
+      int fail = 0;
+      if (node != 0) {
+        int state = automaton.fail[node];
+        while (state != 0 && trieChild(trie, state, c) < 0)
+          state = automaton.fail[state];
+        fail = std::max(trieChild(trie, state, c), 0);
+      }
+      automaton.fail[child] = qint16(fail);
+      automaton.output[child] = trie.nodes[child].alias >= 0
+                                    ? qint16(child)
+                                    : automaton.output[fail];
+      automaton.depth[child] = qint8(automaton.depth[node] + 1);
+      queue[tail++] = qint16(child);
+    }
+  }
+  return automaton;
+}
+
+constexpr AliasAutomaton kAliasAutomaton = buildAliasAutomaton();
+
+int automatonStep(int state, char c) {
+  while (true) {
+    const int child = trieChild(kAliasTrie, state, c);
+    if (child >= 0)
+      return child;
+    if (state == 0)
+      return 0;
+    state = kAliasAutomaton.fail[state];
+  }
+}
+
+// Typed text in key form
+struct FoldedName {
+  char key[kMaxKeyLength];
+  int length = 0;
+};
+
+bool foldName(QStringView name, FoldedName &out) {
+  bool numberOnly = true;
+  bool space = false;
+  for (QChar ch : name) {
+    const char16_t u = ch.unicode();
+    if (u == '.')
+      continue;
+    if (ch.isSpace()) {
+      space = out.length > 0;
+      continue;
+    }
+    if (u > 0x7f)
+      return false; // No such key
+    if (space && !numberOnly) {
+      if (out.length == kMaxKeyLength)
+        return false;
+      out.key[out.length++] = ' ';
+    }
+    space = false;
+    if (out.length == kMaxKeyLength)
+      return false;
+    const char c = char(u);
+    out.key[out.length++] = c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+    numberOnly = numberOnly && c >= '0' && c <= '9';
+  }
+  return out.length > 0;
+}
+
+int findExact(const FoldedName &name) {
+  const quint32 hash = hashKey(name.key, name.length);
+  const int slot =
+      hashSlot(hash, kAliasHash.displacements[hash & (kHashBuckets - 1)]);
+  const int alias = kAliasHash.entries[slot];
+  if (alias < 0)
+    return 0;
+  const char *key = kBookAliases[alias].key;
+  for (int i = 0; i < name.length; ++i) {
+    if (key[i] != name.key[i])
+      return 0;
+  }
+  return key[name.length] == 0 ? kBookAliases[alias].book : 0;
+}
+
+// Trie node whose keys start with name, -1 if none
+int findPrefix(const FoldedName &name) {
+  int node = 0;
+  for (int i = 0; i < name.length && node >= 0; ++i) {
+    node = kAliasTrie.nodes[node].child;
+    while (node >= 0 && kAliasTrie.nodes[node].c != name.key[i])
+      node = kAliasTrie.nodes[node].sibling;
+  }
+  return node;
+}
+
+// For each book with a key under node, the fewest characters left to type
+// (kMaxKeyLength + 1 for the others)
+void remainingLengths(int node, int (&remaining)[kCanonicalBookCount + 1]) {
+  for (int &r : remaining)
+    r = kMaxKeyLength + 1;
+  struct Pending {
+    int node;
+    int depth;
+  };
+  // Depth-first; at most one pending sibling per level
+  Pending stack[kMaxKeyLength + 2];
+  int top = 0;
+  stack[top++] = {node, 0};
+  bool root = true;
+  while (top > 0) {
+    const Pending p = stack[--top];
+    const TrieNode &n = kAliasTrie.nodes[p.node];
+    if (n.alias >= 0) {
+      int &r = remaining[kBookAliases[n.alias].book];
+      r = std::min(r, p.depth);
+    }
+    if (!root && n.sibling >= 0)
+      stack[top++] = {n.sibling, p.depth};
+    if (n.child >= 0)
+      stack[top++] = {n.child, p.depth + 1};
+    root = false;
+  }
+}
+} // namespace
+
+BookLookup lookupBookName(QStringView name) {
+  FoldedName folded;
+  if (!foldName(name, folded))
+    return {};
+  if (int book = findExact(folded))
+    return {BookMatch::Exact, book};
+  if (folded.length < 2)
+    return {};
+  const int node = findPrefix(folded);
+  if (node < 0)
+    return {};
+
+  int remaining[kCanonicalBookCount + 1];
+  remainingLengths(node, remaining);
+  int book = 0;
+  for (int b = 1; b <= kCanonicalBookCount; ++b) {
+    if (remaining[b] > kMaxKeyLength)
+      continue;
+    if (book)
+      return {BookMatch::Ambiguous, 0};
+    book = b;
+  }
+  return {BookMatch::Prefix, book};
+}
+
+int completeBookName(QStringView prefix, int *out, int capacity) {
+  FoldedName folded;
+  if (capacity <= 0 || !foldName(prefix, folded))
+    return 0;
+  const int node = findPrefix(folded);
+  if (node < 0)
+    return 0;
+
+  int remaining[kCanonicalBookCount + 1];
+  remainingLengths(node, remaining);
+  int count = 0;
+  for (int length = 0; length <= kMaxKeyLength; ++length) {
+    for (int b = 1; b <= kCanonicalBookCount; ++b) {
+      if (remaining[b] != length)
+        continue;
+      out[count++] = b;
+      if (count == capacity)
+        return count;
+    }
+  }
+  return count;
+}
+void findBookNames(QStringView text, std::vector<BookMention> &out) {
+  // Text positions of the characters fed to the automaton, the last
+  // kMaxKeyLength of them: where a key ending at the current one starts
+  qsizetype fed[kMaxKeyLength];
+  qint64 count = 0;
+  std::vector<BookMention> found;
+  auto feed = [&](char c, qsizetype pos, int &state) {
+    fed[count++ % kMaxKeyLength] = pos;
+    state = automatonStep(state, c);
+    for (int node = kAliasAutomaton.output[state]; node >= 0;
+         node = kAliasAutomaton.output[kAliasAutomaton.fail[node]]) {
+      const qsizetype start =
+          fed[(count - kAliasAutomaton.depth[node]) % kMaxKeyLength];
+      const qsizetype end = pos + 1;
+      // Whole words only, though a number may follow ("Gen1:1")
+      if ((start == 0 || !text[start - 1].isLetterOrNumber()) &&
+          (end == text.size() || !text[end].isLetter()))
+        found.push_back({start, end - start,
+                         kBookAliases[kAliasTrie.nodes[node].alias].book});
+    }
+  };
+
+  // Folds like foldName: dots dropped, spacing collapsed to one space except
+  // after a leading number. Any other character ends the name.
+  int state = 0;
+  bool numberOnly = true; // The word so far
+  qsizetype space = -1;   // Spacing pending since this position
+  for (qsizetype i = 0; i < text.size(); ++i) {
+    const char16_t u = text[i].unicode();
+    if (u == '.')
+      continue;
+    if (text[i].isSpace()) {
+      if (space < 0)
+        space = i;
+      continue;
+    }
+    const char c = u >= 'A' && u <= 'Z' ? char(u - 'A' + 'a') : char(u);
+    const bool digit = c >= '0' && c <= '9';
+    if (u > 0x7f || !(digit || (c >= 'a' && c <= 'z'))) {
+      state = 0;
+      numberOnly = true;
+      space = -1;
+      continue;
+    }
+    if (space >= 0) {
+      if (!numberOnly) {
+        if (state != 0) // No key starts with a space
+          feed(' ', space, state);
+        numberOnly = true;
+      }
+      space = -1;
+    }
+    feed(c, i, state);
+    numberOnly = numberOnly && digit;
+  }
+
+  std::sort(found.begin(), found.end(),
+            [](const BookMention &a, const BookMention &b) {
+              return a.start != b.start ? a.start < b.start
+                                        : a.length > b.length;
+            });
+  qsizetype end = 0;
+  for (const BookMention &mention : found) {
+    if (mention.start < end)
+      continue;
+    out.push_back(mention);
+    end = mention.start + mention.length;
+  }
+}
+} // namespace Bible
@@ -0,0 +1,139 @@
+#pragma once
+#include <QString>
+#include <QStringView>
+#include <vector>
+
+namespace Bible {
+enum class Testament { Old, New };
+
+struct CanonicalBook {
+  const char *name; // Normalized English name
+  Testament testament;
+  int chapters;
+};
+
+// The 66 books in canonical order. A book's number is its index + 1, which
+// is also the book field of a VerseId.
+inline constexpr CanonicalBook kCanonicalBooks[] = {
+    // Old Testament
+    {"Genesis", Testament::Old, 50},
+    {"Exodus", Testament::Old, 40},
+    {"Leviticus", Testament::Old, 27},
+    {"Numbers", Testament::Old, 36},
+    {"Deuteronomy", Testament::Old, 34},
+    {"Joshua", Testament::Old, 24},
+    {"Judges", Testament::Old, 21},
+    {"Ruth", Testament::Old, 4},
+    {"1 Samuel", Testament::Old, 31},
+    {"2 Samuel", Testament::Old, 24},
+    {"1 Kings", Testament::Old, 22},
+    {"2 Kings", Testament::Old, 25},
+    {"1 Chronicles", Testament::Old, 29},
+    {"2 Chronicles", Testament::Old, 36},
+    {"Ezra", Testament::Old, 10},
+    {"Nehemiah", Testament::Old, 13},
+    {"Esther", Testament::Old, 10},
+    {"Job", Testament::Old, 42},
+    {"Psalms", Testament::Old, 150},
+    {"Proverbs", Testament::Old, 31},
+    {"Ecclesiastes", Testament::Old, 12},
+    {"Song of Solomon", Testament::Old, 8},
+    {"Isaiah", Testament::Old, 66},
+    {"Jeremiah", Testament::Old, 52},
+    {"Lamentations", Testament::Old, 5},
+    {"Ezekiel", Testament::Old, 48},
+    {"Daniel", Testament::Old, 12},
+    {"Hosea", Testament::Old, 14},
+    {"Joel", Testament::Old, 3},
+    {"Amos", Testament::Old, 9},
+    {"Obadiah", Testament::Old, 1},
+    {"Jonah", Testament::Old, 4},
+    {"Micah", Testament::Old, 7},
+    {"Nahum", Testament::Old, 3},
+    {"Habakkuk", Testament::Old, 3},
+    {"Zephaniah", Testament::Old, 3},
+    {"Haggai", Testament::Old, 2},
+    {"Zechariah", Testament::Old, 14},
+    {"Malachi", Testament::Old, 4},
+    // New Testament
+    {"Matthew", Testament::New, 28},
+    {"Mark", Testament::New, 16},
+    {"Luke", Testament::New, 24},
+    {"John", Testament::New, 21},
+    {"Acts", Testament::New, 28},
+    {"Romans", Testament::New, 16},
+    {"1 Corinthians", Testament::New, 16},
+    {"2 Corinthians", Testament::New, 13},
+    {"Galatians", Testament::New, 6},
+    {"Ephesians", Testament::New, 6},
+    {"Philippians", Testament::New, 4},
+    {"Colossians", Testament::New, 4},
+    {"1 Thessalonians", Testament::New, 5},
+    {"2 Thessalonians", Testament::New, 3},
+    {"1 Timothy", Testament::New, 6},
+    {"2 Timothy", Testament::New, 4},
+    {"Titus", Testament::New, 3},
+    {"Philemon", Testament::New, 1},
+    {"Hebrews", Testament::New, 13},
+    {"James", Testament::New, 5},
+    {"1 Peter", Testament::New, 5},
+    {"2 Peter", Testament::New, 3},
+    {"1 John", Testament::New, 5},
+    {"2 John", Testament::New, 1},
+    {"3 John", Testament::New, 1},
+    {"Jude", Testament::New, 1},
+    {"Revelation", Testament::New, 22}};
+
+inline constexpr int kCanonicalBookCount =
+    int(sizeof(kCanonicalBooks) / sizeof(kCanonicalBooks[0]));
+
+// 1-based canonical number of a normalized book name, 0 if not canonical
+inline int canonicalBookNumber(const QString &normalizedName) {
+  for (int i = 0; i < kCanonicalBookCount; ++i) {
+    if (normalizedName == QLatin1String(kCanonicalBooks[i].name))
+      return i + 1;
+  }
+  return 0;
+}
+
+// How a typed book name resolved (see lookupBookName)
+enum class BookMatch {
+  None,      // Not a book name
+  Exact,     // A full name or a known abbreviation
+  Prefix,    // The start of names of exactly one book
+  Ambiguous, // The start of names of several books; see completeBookName
+};
+
+struct BookLookup {
+  BookMatch match = BookMatch::None;
+  int book = 0; // Canonical number for Exact and Prefix, otherwise 0
+};
+
+// Resolves an English or Swahili book name or abbreviation, ignoring case,
+// dots and spacing ("Gen", "1 Sam.", "1sam", "Mwanzo", "wimbo ulio bora").
+// Inputs of two or more characters may also be the start of a name. Uses
+// tables generated at compile time and does not allocate.
+BookLookup lookupBookName(QStringView name);
+
+// Books with a name or abbreviation starting with prefix, for type-ahead:
+// fewest characters left to type first, then canonical order. Writes at most
+// capacity book numbers to out and returns how many it wrote.
+int completeBookName(QStringView prefix, int *out, int capacity);
+
+// A book name found in running text
+struct BookMention {
+  qsizetype start; // In the text
+  qsizetype length;
+  int book; // Canonical number
+};
+
+// Finds the names and abbreviations lookupBookName takes for Exact in
+// running text, as whole words ("1 Sam." and "Mambo ya Walawi" but not the
+// "sam" of "same"). Where two overlap, the one starting first wins, then the
+// longest. Appends them to out in text order.
+//
+// The text is read once, folded as it goes, through an Aho-Corasick
+// automaton over every key, built at compile time from the trie that
+// completeBookName uses.
+void findBookNames(QStringView text, std::vector<BookMention> &out);
+} // namespace Bible
@@ -0,0 +1,258 @@
+#include "BibleCache.h"
+#include "BibleBooks.h"
+#include "BibleManager.h"
+#include "BibleXml.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace {
+QByteArray hashFile(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly))
+    return QByteArray();
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(&file);
+  return hash.result();
+}
+
+template <typename T> void appendRaw(QByteArray &out, const T *data, size_t n) {
+  out.append(reinterpret_cast<const char *>(data), qsizetype(n * sizeof(T)));
+}
+} // namespace
+
+QString BibleCache::cacheDirectory() {
+  QString base =
+      QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  if (base.isEmpty())
+    return QString();
+  return base + "/bible";
+}
+
+std::unique_ptr<BibleStore> BibleCache::load(const QString &sourcePath,
+                                             const QString &versionName) {
+  QFileInfo source(sourcePath);
+  if (!source.exists()) {
+    qWarning() << "Bible source missing:" << sourcePath;
+    return nullptr;
+  }
+  const qint64 sourceSize = source.size();
+  const qint64 sourceMtime = source.lastModified().toMSecsSinceEpoch();
+
+  QString dir = cacheDirectory();
+  QString cachePath;
+  if (!dir.isEmpty() && QDir().mkpath(dir))
+    cachePath = dir + "/" + versionName + ".cpbible";
+
+  // 1. Reuse the compiled image when it still matches the source
+  if (!cachePath.isEmpty() && QFile::exists(cachePath)) {
+    auto file = std::make_unique<QFile>(cachePath);
+    if (file->open(QIODevice::ReadOnly)) {
+      auto store = BibleStore::fromFile(std::move(file));
+      if (!store) {
+        qWarning() << "Bible cache is corrupt or outdated, rebuilding:"
+                   << cachePath;
+      } else if (store->header().sourceSize == sourceSize) {
+        // mtime changes on copy/reinstall; fall back to the content hash
+        if (store->header().sourceMtime == sourceMtime ||
+            hashFile(sourcePath) ==
+                QByteArray(store->header().sourceHash,
+                           sizeof(store->header().sourceHash))) {
+          return store;
+        }
+      }
+      if (store)
+        qDebug() << "Bible cache is stale, rebuilding:" << cachePath;
+    }
+  }
+
+  // 2. Compile from XML
+  QByteArray image = compile(sourcePath);
+  if (image.isEmpty())
+    return nullptr;
+
+  // 3. Persist and map it; keep the in-memory image if that fails
+  if (!cachePath.isEmpty()) {
+    QSaveFile out(cachePath);
+    if (out.open(QIODevice::WriteOnly) && out.write(image) == image.size() &&
+        out.commit()) {
+      auto file = std::make_unique<QFile>(cachePath);
+      if (file->open(QIODevice::ReadOnly)) {
+        if (auto store = BibleStore::fromFile(std::move(file)))
+          return store;
+      }
+    } else {
+      qWarning() << "Could not write Bible cache:" << cachePath;
+    }
+  }
+  return BibleStore::fromBuffer(image);
+}
+
+QByteArray BibleCache::compile(const QString &sourcePath) {
+  QFile file(sourcePath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    qWarning() << "Failed to open Bible XML:" << sourcePath;
+    return QByteArray();
+  }
+  // Parse the file in place through a mapping; read it only if it cannot be
+  // mapped. Verse texts stay views into it until they are written out.
+  QByteArray buffer;
+  const uchar *mapped = file.size() > 0 ? file.map(0, file.size()) : nullptr;
+  if (!mapped)
+    buffer = file.readAll();
+  const QByteArrayView source =
+      mapped ? QByteArrayView(mapped, file.size()) : QByteArrayView(buffer);
+
+  struct ParsedVerse {
+    VerseId id;
+    QByteArrayView text; // Raw, in source
+    bool decode;         // See BibleXmlReader::textNeedsDecoding
+  };
+  std::vector<ParsedVerse> verses;
+  // Book number -> localized name (first one seen wins). Canonical books use
+  // their canonical number; anything else is numbered after Revelation in
+  // order of appearance.
+  std::map<int, QString> bookNames;
+  std::map<QString, int> extraBooks; // Normalized name -> number
+  auto bookNumber = [&](const QString &name) {
+    QString normalized = BibleManager::normalizeBookName(name);
+    int number = Bible::canonicalBookNumber(normalized);
+    if (number == 0) {
+      auto it = extraBooks.find(normalized);
+      if (it == extraBooks.end()) {
+        number = Bible::kCanonicalBookCount + int(extraBooks.size()) + 1;
+        extraBooks.emplace(normalized, number);
+      } else {
+        number = it->second;
+      }
+    }
+    bookNames.emplace(number, name);
+    return number;
+  };
+  int currentBook = 0;
+  int currentChapter = 0;
+  int skipped = 0;
+
+  BibleXmlReader xml(source);
+  while (!xml.atEnd()) {
+    const BibleXmlReader::Token token = xml.readNext();
+    if (token == BibleXmlReader::Book) {
+      currentBook = bookNumber(xml.bookName());
+    } else if (token == BibleXmlReader::Chapter) {
+      currentChapter = xml.number();
+    } else if (token == BibleXmlReader::Verse) {
+      int verseNum = xml.number();
+      if (currentBook == 0) {
+        // Verse outside any <b>: file it under an unnamed book
+        currentBook = bookNumber(QString());
+      }
+      if (currentChapter < 0 || currentChapter > 0xff || verseNum < 0 ||
+          verseNum > 0xff) {
+        ++skipped;
+        continue;
+      }
+      verses.push_back({makeVerseId(currentBook, currentChapter, verseNum),
+                        xml.text(), xml.textNeedsDecoding()});
+    }
+  }
+
+  for (const BibleXmlReader::Recovery &recovery : xml.recoveries())
+    qDebug() << "XML recovery in" << sourcePath << "at byte"
+             << recovery.offset << ":" << recovery.message;
+  if (!xml.recoveries().empty() || xml.legacyMarkup() > 0)
+    qWarning() << "Read past" << xml.recoveries().size()
+               << "markup errors and" << xml.legacyMarkup()
+               << "legacy tags or values in" << sourcePath;
+  if (xml.hasError())
+    qWarning() << "XML Parse Error in" << sourcePath << "at byte"
+               << xml.errorOffset() << ":" << xml.errorString();
+  if (skipped > 0)
+    qWarning() << "Skipped" << skipped << "out-of-range verses in"
+               << sourcePath;
+  if (verses.empty())
+    return QByteArray();
+
+  // Canonical id order; for duplicate ids the last occurrence wins
+  std::stable_sort(verses.begin(), verses.end(),
+                   [](const ParsedVerse &a, const ParsedVerse &b) {
+                     return a.id < b.id;
+                   });
+  std::vector<ParsedVerse> unique;
+  unique.reserve(verses.size());
+  qsizetype textBytes = 0;
+  for (size_t i = 0; i < verses.size(); ++i) {
+    if (i + 1 < verses.size() && verses[i + 1].id == verses[i].id)
+      continue;
+    textBytes += verses[i].text.size();
+    unique.push_back(verses[i]);
+  }
+
+  // Assemble tables. The book table is indexed by book number.
+  std::vector<BibleStore::BookEntry> books(bookNames.rbegin()->first);
+  std::vector<VerseId> ids;
+  std::vector<quint32> offsets;
+  QByteArray blob;
+  blob.reserve(textBytes);
+  ids.reserve(unique.size());
+  offsets.reserve(unique.size() + 1);
+
+  size_t v = 0;
+  for (int b = 0; b < int(books.size()); ++b) {
+    books[b].firstVerse = quint32(ids.size());
+    while (v < unique.size() && verseIdBook(unique[v].id) == b + 1) {
+      ids.push_back(unique[v].id);
+      offsets.push_back(quint32(blob.size()));
+      // The only copy of the text: decoding never makes it longer
+      if (unique[v].decode)
+        BibleXmlReader::appendText(blob, unique[v].text);
+      else
+        blob.append(unique[v].text);
+      ++v;
+    }
+    books[b].verseCount = quint32(ids.size()) - books[b].firstVerse;
+  }
+  offsets.push_back(quint32(blob.size()));
+
+  for (int b = 0; b < int(books.size()); ++b) {
+    auto it = bookNames.find(b + 1);
+    QByteArray name = it != bookNames.end() ? it->second.toUtf8() : QByteArray();
+    books[b].nameOffset = quint32(blob.size());
+    books[b].nameLength = quint32(name.size());
+    blob.append(name);
+  }
+
+  BibleStore::ImageHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, BibleStore::kMagic, sizeof(header.magic));
+  header.formatVersion = BibleStore::kFormatVersion;
+  header.importerVersion = BibleStore::kImporterVersion;
+  header.bookCount = quint32(books.size());
+  header.verseCount = quint32(ids.size());
+  header.blobSize = quint32(blob.size());
+  header.sourceSize = source.size();
+  header.sourceMtime =
+      QFileInfo(sourcePath).lastModified().toMSecsSinceEpoch();
+  QByteArray hash = QCryptographicHash::hash(source, QCryptographicHash::Sha1);
+  std::memcpy(header.sourceHash, hash.constData(),
+              std::min<size_t>(hash.size(), sizeof(header.sourceHash)));
+
+  QByteArray image;
+  image.reserve(qsizetype(sizeof(header) + books.size() * sizeof(books[0]) +
+                          (ids.size() + offsets.size()) * sizeof(quint32) +
+                          blob.size()));
+  appendRaw(image, &header, 1);
+  appendRaw(image, books.data(), books.size());
+  appendRaw(image, ids.data(), ids.size());
+  appendRaw(image, offsets.data(), offsets.size());
+  image.append(blob);
+  return image;
+}
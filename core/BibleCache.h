@@ -0,0 +1,23 @@
+#pragma once
+#include "BibleStore.h"
+#include <QString>
+#include <memory>
+
+// Compiles assets/bible/*.xml into BibleStore images and keeps them in the
+// user cache directory, so later launches memory-map the image instead of
+// re-parsing the XML.
+class BibleCache {
+public:
+  // Returns a store for the XML source. A cached image is reused when its
+  // recorded source size/mtime (or, failing that, SHA-1) still match;
+  // missing, stale or corrupt images are rebuilt from the XML.
+  static std::unique_ptr<BibleStore> load(const QString &sourcePath,
+                                          const QString &versionName);
+
+  // Directory holding the compiled images
+  static QString cacheDirectory();
+
+private:
+  // Parses the XML source into a complete image (header included)
+  static QByteArray compile(const QString &sourcePath);
+};
@@ -0,0 +1,302 @@
+#include "BibleCorpus.h"
+#include "BibleStore.h"
+#include <QChar>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BIBLE_CORPUS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define BIBLE_CORPUS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+// Offset of the first occurrence of needle (at least two bytes) in text, or
+// -1. The SIMD kernels compare a block of candidate positions at once
+// against the needle's first and last bytes and only memcmp() the positions
+// where both match, which in prose are few.
+using FindFunction = qsizetype (*)(const char *text, qsizetype size,
+                                   const char *needle, qsizetype length);
+
+qsizetype findScalar(const char *text, qsizetype size, const char *needle,
+                     qsizetype length) {
+  if (size < length)
+    return -1;
+  const char *end = text + size - length + 1;
+  const char *p = text;
+  while (p < end) {
+    p = static_cast<const char *>(std::memchr(p, needle[0], size_t(end - p)));
+    if (!p)
+      return -1;
+    if (p[length - 1] == needle[length - 1] &&
+        std::memcmp(p + 1, needle + 1, size_t(length - 2)) == 0)
+      return p - text;
+    ++p;
+  }
+  return -1;
+}
+
+#ifdef BIBLE_CORPUS_X86
+qsizetype findSse2(const char *text, qsizetype size, const char *needle,
+                   qsizetype length) {
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[length - 1]);
+  qsizetype i = 0;
+  for (; i + length - 1 + 16 <= size; i += 16) {
+    const __m128i a =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+    const __m128i b = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(text + i + length - 1));
+    unsigned mask = unsigned(_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+    while (mask) {
+      const qsizetype at = i + qCountTrailingZeroBits(mask);
+      if (std::memcmp(text + at + 1, needle + 1, size_t(length - 2)) == 0)
+        return at;
+      mask &= mask - 1;
+    }
+  }
+  const qsizetype tail = findScalar(text + i, size - i, needle, length);
+  return tail < 0 ? -1 : i + tail;
+}
+
+#ifndef _MSC_VER
+__attribute__((target("avx2")))
+#endif
+qsizetype findAvx2(const char *text, qsizetype size, const char *needle,
+                   qsizetype length) {
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i last = _mm256_set1_epi8(needle[length - 1]);
+  qsizetype i = 0;
+  for (; i + length - 1 + 32 <= size; i += 32) {
+    const __m256i a =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(text + i));
+    const __m256i b = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(text + i + length - 1));
+    quint32 mask = quint32(_mm256_movemask_epi8(_mm256_and_si256(
+        _mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))));
+    while (mask) {
+      const qsizetype at = i + qCountTrailingZeroBits(mask);
+      if (std::memcmp(text + at + 1, needle + 1, size_t(length - 2)) == 0)
+        return at;
+      mask &= mask - 1;
+    }
+  }
+  const qsizetype tail = findSse2(text + i, size - i, needle, length);
+  return tail < 0 ? -1 : i + tail;
+}
+
+bool cpuHasAvx2() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+  // The OS must save the YMM registers too (OSXSAVE, then XCR0 bits 1-2)
+  __cpuid(info, 1);
+  if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) ||
+      (_xgetbv(0) & 6) != 6)
+    return false;
+  __cpuidex(info, 7, 0);
+  return info[1] & (1 << 5);
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+#ifdef BIBLE_CORPUS_NEON
+qsizetype findNeon(const char *text, qsizetype size, const char *needle,
+                   qsizetype length) {
+  const uint8x16_t first = vdupq_n_u8(uint8_t(needle[0]));
+  const uint8x16_t last = vdupq_n_u8(uint8_t(needle[length - 1]));
+  const auto *bytes = reinterpret_cast<const uint8_t *>(text);
+  qsizetype i = 0;
+  for (; i + length - 1 + 16 <= size; i += 16) {
+    const uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(bytes + i), first),
+                                   vceqq_u8(vld1q_u8(bytes + i + length - 1),
+                                            last));
+    // NEON has no movemask; narrowing leaves four bits per byte
+    quint64 mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    while (mask) {
+      const int bit = int(qCountTrailingZeroBits(mask));
+      const qsizetype at = i + bit / 4;
+      if (std::memcmp(text + at + 1, needle + 1, size_t(length - 2)) == 0)
+        return at;
+      mask &= ~(quint64(0xf) << (bit & ~3));
+    }
+  }
+  const qsizetype tail = findScalar(text + i, size - i, needle, length);
+  return tail < 0 ? -1 : i + tail;
+}
+#endif
+
+// Picked once, on first use
+FindFunction findFunction() {
+  static const FindFunction function = [] {
+#if defined(BIBLE_CORPUS_X86)
+    return cpuHasAvx2() ? findAvx2 : findSse2;
+#elif defined(BIBLE_CORPUS_NEON)
+    return findNeon;
+#else
+    return findScalar;
+#endif
+  }();
+  return function;
+}
+
+void appendUtf8(std::string &out, char16_t c) {
+  if (c < 0x80) {
+    out += char(c);
+  } else if (c < 0x800) {
+    out += char(0xc0 | (c >> 6));
+    out += char(0x80 | (c & 0x3f));
+  } else {
+    out += char(0xe0 | (c >> 12));
+    out += char(0x80 | ((c >> 6) & 0x3f));
+    out += char(0x80 | (c & 0x3f));
+  }
+}
+} // namespace
+
+std::unique_ptr<BibleCorpus> BibleCorpus::build(const BibleStore &store) {
+  std::unique_ptr<BibleCorpus> corpus(new BibleCorpus);
+  const int count = store.verseCount();
+  size_t bytes = 0;
+  for (int i = 0; i < count; ++i)
+    bytes += size_t(store.verseUtf8(i).size()) + 1;
+  corpus->m_text.reserve(bytes);
+  corpus->m_verseStarts.reserve(size_t(count) + 1);
+
+  std::string &out = corpus->m_text;
+  for (int i = 0; i < count; ++i) {
+    corpus->m_verseStarts.push_back(quint32(out.size()));
+    const QByteArrayView text = store.verseUtf8(i);
+    const auto *p = reinterpret_cast<const uchar *>(text.data());
+    const qsizetype n = text.size();
+    qsizetype j = 0;
+    while (j < n) {
+      const uchar c = p[j];
+      if (c < 0x80) {
+        out += char(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+        ++j;
+      } else if ((c & 0xe0) == 0xc0 && j + 1 < n) {
+        appendUtf8(out, QChar(char16_t(((c & 0x1f) << 6) | (p[j + 1] & 0x3f)))
+                            .toLower()
+                            .unicode());
+        j += 2;
+      } else if ((c & 0xf0) == 0xe0 && j + 2 < n) {
+        appendUtf8(out, QChar(char16_t(((c & 0x0f) << 12) |
+                                       ((p[j + 1] & 0x3f) << 6) |
+                                       (p[j + 2] & 0x3f)))
+                            .toLower()
+                            .unicode());
+        j += 3;
+      } else {
+        // Outside the BMP (kept as is, like QChar::toLower on a surrogate)
+        // or malformed
+        out += char(c);
+        ++j;
+      }
+    }
+    out += '\0';
+  }
+  corpus->m_verseStarts.push_back(quint32(out.size()));
+  return corpus;
+}
+
+QByteArray BibleCorpus::fold(QStringView text) {
+  std::string out;
+  out.reserve(size_t(text.size()));
+  for (qsizetype i = 0; i < text.size(); ++i) {
+    const QChar c = text[i];
+    if (c.isHighSurrogate() && i + 1 < text.size() &&
+        text[i + 1].isLowSurrogate()) {
+      const char32_t ucs = QChar::surrogateToUcs4(c, text[i + 1]);
+      out += char(0xf0 | (ucs >> 18));
+      out += char(0x80 | ((ucs >> 12) & 0x3f));
+      out += char(0x80 | ((ucs >> 6) & 0x3f));
+      out += char(0x80 | (ucs & 0x3f));
+      ++i;
+    } else {
+      appendUtf8(out, c.toLower().unicode());
+    }
+  }
+  return QByteArray(out.data(), qsizetype(out.size()));
+}
+
+std::vector<quint32> BibleCorpus::find(QByteArrayView needle, int first,
+                                       int last, size_t limit) const {
+  std::vector<quint32> verses;
+  if (needle.isEmpty() || first >= last)
+    return verses;
+  const FindFunction find = findFunction();
+  const char *text = m_text.data();
+  const qsizetype size = qsizetype(m_verseStarts[size_t(last)]);
+  qsizetype pos = qsizetype(m_verseStarts[size_t(first)]);
+  while (pos < size && verses.size() < limit) {
+    qsizetype at;
+    if (needle.size() == 1) {
+      const void *p = std::memchr(text + pos, needle[0], size_t(size - pos));
+      at = p ? static_cast<const char *>(p) - text : -1;
+    } else {
+      at = find(text + pos, size - pos, needle.data(), needle.size());
+      if (at >= 0)
+        at += pos;
+    }
+    if (at < 0)
+      break;
+    // The verse holding the hit; its other hits do not matter, so go on
+    // from the next verse
+    const auto next = std::upper_bound(m_verseStarts.begin(),
+                                       m_verseStarts.end(), quint32(at));
+    verses.push_back(quint32(next - m_verseStarts.begin() - 1));
+    pos = qsizetype(*next);
+  }
+  return verses;
+}
+
+std::vector<std::pair<int, int>>
+BibleCorpus::textRanges(quint32 verse, QByteArrayView needle) const {
+  std::vector<std::pair<int, int>> ranges;
+  const QByteArrayView text = this->verse(verse);
+  if (needle.isEmpty())
+    return ranges;
+
+  // UTF-16 offset of every byte; folding kept the unit count of the original
+  std::vector<int> utf16(size_t(text.size()) + 1);
+  int units = 0;
+  for (qsizetype i = 0; i < text.size(); ++i) {
+    utf16[size_t(i)] = units;
+    const uchar c = uchar(text[i]);
+    if ((c & 0xc0) != 0x80)
+      units += c >= 0xf0 ? 2 : 1; // Four-byte sequences are surrogate pairs
+  }
+  utf16[size_t(text.size())] = units;
+
+  const auto *begin = text.data();
+  const auto *end = begin + text.size();
+  const auto *p = begin;
+  while (true) {
+    p = std::search(p, end, needle.data(), needle.data() + needle.size());
+    if (p == end)
+      break;
+    const int start = utf16[size_t(p - begin)];
+    const int stop = utf16[size_t(p - begin + needle.size())];
+    // Merge overlaps ("aa" in "aaa")
+    if (!ranges.empty() && start <= ranges.back().first + ranges.back().second)
+      ranges.back().second = stop - ranges.back().first;
+    else
+      ranges.push_back({start, stop - start});
+    ++p;
+  }
+  return ranges;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QStringView>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class BibleStore;
+
+// The verse text of one BibleStore, lower-cased once into a single buffer for
+// raw substring search ("ness of" finds "righteousness of").
+//
+// Verses follow each other in canonical order, each ended by a NUL byte so a
+// match never runs from one verse into the next. Folding lower-cases each
+// UTF-16 code unit, so a folded verse has as many UTF-16 units as the
+// original and offsets carry over for highlighting.
+class BibleCorpus {
+public:
+  // Folds every verse of the store; runs on a loader thread
+  static std::unique_ptr<BibleCorpus> build(const BibleStore &store);
+
+  // Folds a query the way the corpus is folded
+  static QByteArray fold(QStringView text);
+
+  int verseCount() const { return int(m_verseStarts.size()) - 1; }
+  // Folded UTF-8 text of a verse, without its terminator
+  QByteArrayView verse(quint32 verse) const {
+    return QByteArrayView(m_text.data() + m_verseStarts[verse],
+                          m_verseStarts[verse + 1] - m_verseStarts[verse] - 1);
+  }
+  qsizetype size() const { return qsizetype(m_text.size()); }
+  // Heap memory held by the corpus
+  qint64 memoryBytes() const {
+    return qint64(m_text.capacity() +
+                  m_verseStarts.capacity() * sizeof(quint32));
+  }
+
+  // Indices of the verses in [first, last) containing the folded needle,
+  // ascending, at most limit of them. Scans with the widest SIMD kernel the
+  // CPU supports; safe to run on several threads at once.
+  std::vector<quint32> find(QByteArrayView needle, int first, int last,
+                            size_t limit) const;
+
+  // Occurrences of the folded needle in a verse, as [start, length) ranges
+  // of its QString text (UTF-16 code units), for highlighting
+  std::vector<std::pair<int, int>> textRanges(quint32 verse,
+                                              QByteArrayView needle) const;
+
+private:
+  BibleCorpus() = default;
+
+  std::string m_text;
+  // Offset of each verse in m_text, then the end of the buffer
+  std::vector<quint32> m_verseStarts;
+};
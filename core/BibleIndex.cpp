@@ -0,0 +1,153 @@
+#include "BibleIndex.h"
+#include "BibleStore.h"
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+// Postings of one term while the index is being built
+struct TermBuilder {
+  std::vector<quint32> verses;
+  std::vector<quint32> positionStarts; // verse -> first entry in positions
+  std::vector<quint16> positions;
+};
+} // namespace
+
+std::unique_ptr<BibleIndex> BibleIndex::build(const BibleStore &store) {
+  std::unordered_map<std::string, quint32> ids;
+  std::vector<TermBuilder> builders;
+  std::string key;
+  std::vector<quint16> lengths;
+  qint64 totalLength = 0;
+
+  const int verses = store.verseCount();
+  lengths.reserve(size_t(verses));
+  for (int v = 0; v < verses; ++v) {
+    int length = 0;
+    tokenize(store.verseUtf8(v), [&](QByteArrayView token, int position,
+                                     qsizetype, qsizetype) {
+      if (position > 0xffff)
+        return;
+      length = position + 1;
+      key.assign(token.data(), size_t(token.size()));
+      auto it = ids.find(key);
+      if (it == ids.end()) {
+        it = ids.emplace(key, quint32(builders.size())).first;
+        builders.emplace_back();
+      }
+      TermBuilder &builder = builders[it->second];
+      if (builder.verses.empty() || builder.verses.back() != quint32(v)) {
+        builder.verses.push_back(quint32(v));
+        builder.positionStarts.push_back(quint32(builder.positions.size()));
+      }
+      builder.positions.push_back(quint16(position));
+    });
+    lengths.push_back(quint16(length));
+    totalLength += length;
+  }
+
+  // Freeze into sorted, contiguous arrays
+  std::vector<const std::string *> terms(builders.size());
+  for (const auto &[term, id] : ids)
+    terms[id] = &term;
+  std::vector<quint32> order(builders.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](quint32 a, quint32 b) {
+    return *terms[a] < *terms[b];
+  });
+
+  std::unique_ptr<BibleIndex> index(new BibleIndex());
+  index->m_store = &store;
+  index->m_verseCount = verses;
+  index->m_verseLengths = std::move(lengths);
+  index->m_averageVerseLength = verses > 0 ? double(totalLength) / verses : 0;
+  size_t termBytes = 0;
+  size_t postingCount = 0;
+  size_t positionCount = 0;
+  for (size_t t = 0; t < builders.size(); ++t) {
+    termBytes += terms[t]->size();
+    postingCount += builders[t].verses.size();
+    positionCount += builders[t].positions.size();
+  }
+  index->m_terms.reserve(termBytes);
+  index->m_termOffsets.reserve(order.size() + 1);
+  index->m_postings.reserve(postingCount);
+  index->m_postingOffsets.reserve(order.size() + 1);
+  index->m_positions.reserve(positionCount);
+  index->m_positionOffsets.reserve(postingCount + 1);
+
+  for (quint32 id : order) {
+    const TermBuilder &builder = builders[id];
+    index->m_termOffsets.push_back(quint32(index->m_terms.size()));
+    index->m_terms += *terms[id];
+    index->m_postingOffsets.push_back(quint32(index->m_postings.size()));
+    index->m_postings.insert(index->m_postings.end(), builder.verses.begin(),
+                             builder.verses.end());
+    const quint32 base = quint32(index->m_positions.size());
+    for (quint32 start : builder.positionStarts)
+      index->m_positionOffsets.push_back(base + start);
+    index->m_positions.insert(index->m_positions.end(),
+                              builder.positions.begin(),
+                              builder.positions.end());
+  }
+  index->m_termOffsets.push_back(quint32(index->m_terms.size()));
+  index->m_postingOffsets.push_back(quint32(index->m_postings.size()));
+  index->m_positionOffsets.push_back(quint32(index->m_positions.size()));
+  return index;
+}
+
+BibleIndex::Positions BibleIndex::positions(int t, quint32 verse) const {
+  const Postings list = postings(t);
+  const quint32 *it = std::lower_bound(list.begin(), list.end(), verse);
+  if (it == list.end() || *it != verse)
+    return {};
+  const size_t posting = size_t(it - m_postings.data());
+  return {m_positions.data() + m_positionOffsets[posting],
+          m_positions.data() + m_positionOffsets[posting + 1]};
+}
+
+qint64 BibleIndex::memoryBytes() const {
+  return qint64(m_verseLengths.capacity() * sizeof(quint16) +
+                m_terms.capacity() +
+                m_termOffsets.capacity() * sizeof(quint32) +
+                m_postingOffsets.capacity() * sizeof(quint32) +
+                m_postings.capacity() * sizeof(quint32) +
+                m_positionOffsets.capacity() * sizeof(quint32) +
+                m_positions.capacity() * sizeof(quint16));
+}
+
+int BibleIndex::findTerm(QByteArrayView token) const {
+  int lo = 0;
+  int hi = termCount();
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (term(mid).compare(token) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo < termCount() && term(lo) == token ? lo : -1;
+}
+
+std::pair<int, int> BibleIndex::prefixTerms(QByteArrayView prefix) const {
+  int lo = 0;
+  int hi = termCount();
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (term(mid).compare(prefix) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  // Terms sharing the prefix follow the lower bound contiguously
+  const int first = lo;
+  hi = termCount();
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (term(mid).startsWith(prefix))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return {first, lo};
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <QByteArrayView>
+#include <QChar>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class BibleStore;
+
+// Inverted index over the verse text of one BibleStore.
+//
+// Text is split into case-folded word tokens (see tokenize()). Every distinct
+// token is a "term"; terms are kept sorted so a prefix maps to a contiguous
+// run of term numbers. Each term has a posting list: the ascending indices
+// (into the store's verse table) of the verses containing it, and for each of
+// those verses the token positions where it occurs. Since the verse table is
+// in canonical order, posting lists are too.
+class BibleIndex {
+public:
+  template <typename T> struct List {
+    const T *first = nullptr;
+    const T *last = nullptr;
+
+    const T *begin() const { return first; }
+    const T *end() const { return last; }
+    int size() const { return int(last - first); }
+    bool empty() const { return first == last; }
+  };
+  // Ascending verse indices of one term
+  using Postings = List<quint32>;
+  // Ascending token positions of one term within one verse
+  using Positions = List<quint16>;
+
+  // Tokens longer than this are truncated
+  static constexpr int kMaxTokenBytes = 64;
+
+  // Indexes every verse of the store, which must outlive the index. Runs on a
+  // loader thread.
+  static std::unique_ptr<BibleIndex> build(const BibleStore &store);
+
+  // Splits UTF-8 text into lowercase runs of letters and digits, calling
+  // sink(QByteArrayView token, int position, qsizetype byteOffset,
+  // qsizetype byteLength) for each. position counts tokens from 0; the byte
+  // range is the token's extent in the input. Does not allocate.
+  template <typename Sink>
+  static void tokenize(QByteArrayView text, Sink &&sink);
+
+  const BibleStore &store() const { return *m_store; }
+  int verseCount() const { return m_verseCount; }
+  // Tokens in a verse, and the mean over all verses (BM25 length norm)
+  int verseLength(quint32 verse) const { return m_verseLengths[verse]; }
+  double averageVerseLength() const { return m_averageVerseLength; }
+  int termCount() const { return int(m_termOffsets.size()) - 1; }
+  QByteArrayView term(int t) const {
+    return QByteArrayView(m_terms.data() + m_termOffsets[t],
+                          m_termOffsets[t + 1] - m_termOffsets[t]);
+  }
+  Postings postings(int t) const {
+    return {m_postings.data() + m_postingOffsets[t],
+            m_postings.data() + m_postingOffsets[t + 1]};
+  }
+  // Total postings of the terms [first, last)
+  int postingCount(int first, int last) const {
+    return int(m_postingOffsets[last] - m_postingOffsets[first]);
+  }
+  // Positions of term t in a verse; empty if the verse does not contain it
+  Positions positions(int t, quint32 verse) const;
+
+  // Heap memory held by the index
+  qint64 memoryBytes() const;
+
+  // Term number of a folded token, or -1 if no verse contains it
+  int findTerm(QByteArrayView token) const;
+  // [first, last) term numbers of the terms starting with prefix
+  std::pair<int, int> prefixTerms(QByteArrayView prefix) const;
+
+private:
+  BibleIndex() = default;
+
+  const BibleStore *m_store = nullptr;
+  int m_verseCount = 0;
+  double m_averageVerseLength = 0;
+  std::vector<quint16> m_verseLengths;
+  std::string m_terms;                   // Sorted terms, concatenated
+  std::vector<quint32> m_termOffsets;    // term -> offset in m_terms
+  std::vector<quint32> m_postingOffsets; // term -> offset in m_postings
+  std::vector<quint32> m_postings;       // All posting lists, concatenated
+  std::vector<quint32> m_positionOffsets; // posting -> offset in m_positions
+  std::vector<quint16> m_positions;       // All position lists, concatenated
+};
+
+template <typename Sink>
+void BibleIndex::tokenize(QByteArrayView text, Sink &&sink) {
+  const auto *p = reinterpret_cast<const uchar *>(text.data());
+  const qsizetype n = text.size();
+  char buffer[kMaxTokenBytes + 4];
+  int length = 0;
+  int position = 0;
+  qsizetype start = 0;
+
+  qsizetype i = 0;
+  while (i < n) {
+    char32_t c = p[i];
+    int width = 1;
+    bool word;
+    if (c < 0x80) {
+      word = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+      if (c >= 'A' && c <= 'Z') {
+        c += 'a' - 'A';
+        word = true;
+      }
+    } else {
+      // Decode one multi-byte sequence; malformed bytes count as separators
+      if ((c & 0xe0) == 0xc0 && i + 1 < n) {
+        c = ((c & 0x1f) << 6) | (p[i + 1] & 0x3f);
+        width = 2;
+      } else if ((c & 0xf0) == 0xe0 && i + 2 < n) {
+        c = ((c & 0x0f) << 12) | ((p[i + 1] & 0x3f) << 6) | (p[i + 2] & 0x3f);
+        width = 3;
+      } else if ((c & 0xf8) == 0xf0 && i + 3 < n) {
+        c = ((c & 0x07) << 18) | ((p[i + 1] & 0x3f) << 12) |
+            ((p[i + 2] & 0x3f) << 6) | (p[i + 3] & 0x3f);
+        width = 4;
+      } else {
+        c = 0;
+      }
+      word = c != 0 && QChar::isLetterOrNumber(c);
+      if (word)
+        c = QChar::toLower(c);
+    }
+
+    if (word) {
+      if (length == 0)
+        start = i;
+      if (length <= kMaxTokenBytes - 4) {
+        if (c < 0x80) {
+          buffer[length++] = char(c);
+        } else if (c < 0x800) {
+          buffer[length++] = char(0xc0 | (c >> 6));
+          buffer[length++] = char(0x80 | (c & 0x3f));
+        } else if (c < 0x10000) {
+          buffer[length++] = char(0xe0 | (c >> 12));
+          buffer[length++] = char(0x80 | ((c >> 6) & 0x3f));
+          buffer[length++] = char(0x80 | (c & 0x3f));
+        } else {
+          buffer[length++] = char(0xf0 | (c >> 18));
+          buffer[length++] = char(0x80 | ((c >> 12) & 0x3f));
+          buffer[length++] = char(0x80 | ((c >> 6) & 0x3f));
+          buffer[length++] = char(0x80 | (c & 0x3f));
+        }
+      }
+    } else if (length > 0) {
+      sink(QByteArrayView(buffer, length), position++, start, i - start);
+      length = 0;
+    }
+    i += width;
+  }
+  if (length > 0)
+    sink(QByteArrayView(buffer, length), position, start, n - start);
+}
@@ -1,10 +1,95 @@
 #include "BibleManager.h"
+#include "BibleCache.h"
+#include "BibleQuery.h"
 #include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
-#include <QRegularExpression>
-#include <QXmlStreamReader>
+#include <QFileSystemWatcher>
+#include <QPointer>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <algorithm>
+#include <tuple>
+
+struct BibleManager::SearchCursor {
+  struct Hit {
+    float score;
+    int version; // Index into versions
+    quint32 verse;
+  };
+
+  BibleQuery query;
+  // Folded text of a substring search; empty for a keyword search
+  QByteArray substring;
+  std::vector<QString> versions;
+  // Kept alive for paging, even if the version is reloaded meanwhile
+  std::vector<std::shared_ptr<const BibleData>> data;
+  std::vector<Hit> hits; // Every match, unordered
+  // Last hit handed out; the next page starts after it
+  Hit last{0.0f, 0, 0};
+  bool started = false;
+};
+
+struct BibleManager::SearchSession {
+  QString version;
+  std::shared_ptr<const BibleData> data; // Detects a reloaded version
+  QString query;                         // Previous query
+
+  // Last keyword query, all of its matches (ascending verse indices) and,
+  // for a plain word query, each word's BM25 score for each match
+  BibleQuery keywords;
+  bool hasKeywords = false;
+  std::vector<quint32> matches;
+  std::vector<std::vector<float>> wordScores;
+  // Document frequency of the words typed so far in data, by
+  // BibleQuery::wordKey
+  std::map<std::string, qint64> frequencies;
+};
+
+namespace {
+// Best score first; ties in version, then canonical, order
+bool ranksBefore(const BibleManager::SearchCursor::Hit &a,
+                 const BibleManager::SearchCursor::Hit &b) {
+  if (a.score != b.score)
+    return a.score > b.score;
+  if (a.version != b.version)
+    return a.version < b.version;
+  return a.verse < b.verse;
+}
+
+// Calls work(shard) for the shards [0, count), handed out in order to the
+// calling thread and to whatever threads of the global pool are idle, and
+// returns once all are done. Once a call of work returns false, no further
+// shards are handed out; the ones already running finish.
+template <typename Work> void runShards(int count, const Work &work) {
+  std::atomic<int> next{0};
+  std::atomic<bool> stop{false};
+  auto drain = [&] {
+    while (!stop.load(std::memory_order_relaxed)) {
+      const int shard = next.fetch_add(1, std::memory_order_relaxed);
+      if (shard >= count || !work(shard))
+        stop.store(true, std::memory_order_relaxed);
+    }
+  };
+
+  // tryStart() only takes idle threads, so waiting for the helpers below
+  // never waits for unrelated work queued in the pool
+  QThreadPool *pool = QThreadPool::globalInstance();
+  QSemaphore done;
+  int helpers = 0;
+  while (helpers < std::min(count, pool->maxThreadCount()) - 1 &&
+         pool->tryStart([&] {
+           drain();
+           done.release();
+         }))
+    ++helpers;
+  drain();
+  done.acquire(helpers);
+}
+} // namespace
 
 // Forward declaration
 
@@ -13,9 +98,20 @@ BibleManager &BibleManager::instance() {
   return instance;
 }
 
-BibleManager::BibleManager(QObject *parent) : QObject(parent) {}
+BibleManager::BibleManager(QObject *parent)
+    : QObject(parent), published(std::make_shared<const VersionMap>()),
+      loaderPool(new QThreadPool(this)), searchPool(new QThreadPool(this)),
+      rescanTimer(new QTimer(this)) {
+  searchPool->setMaxThreadCount(1);
+  rescanTimer->setSingleShot(true);
+  rescanTimer->setInterval(kRescanDelayMs);
+  connect(rescanTimer, &QTimer::timeout, this, &BibleManager::rescanBibles);
+}
+
+void BibleManager::loadBibles(const QStringList &preload) {
+  if (!knownVersions.empty())
+    return; // Already found
 
-void BibleManager::loadBibles() {
   // Look for assets relative to the executable (standard deployment)
   // or in the current directory (development/IDE)
   QString appDir = QCoreApplication::applicationDirPath();
@@ -43,7 +139,6 @@ void BibleManager::loadBibles() {
 #endif
   };
 
-  QString bibleDir;
   for (const auto &path : searchPaths) {
     if (QDir(path).exists()) {
       bibleDir = path;
@@ -58,676 +153,1021 @@ void BibleManager::loadBibles() {
 
   qDebug() << "Bible assets found at:" << bibleDir;
 
+  knownVersions = scanBibleDir();
+  if (knownVersions.empty())
+    qWarning() << "No Bible versions were found!";
+
+  watcher = new QFileSystemWatcher(this);
+  watcher->addPath(bibleDir);
+  for (const auto &[versionName, filePath] : knownVersions)
+    watcher->addPath(filePath);
+  connect(watcher, &QFileSystemWatcher::directoryChanged, this,
+          [this]() { rescanTimer->start(); });
+  connect(watcher, &QFileSystemWatcher::fileChanged, this,
+          [this](const QString &path) {
+            changedFiles.insert(path);
+            rescanTimer->start();
+          });
+
+  bool preloaded = false;
+  for (const QString &versionName : preload) {
+    requestVersion(versionName);
+    preloaded = preloaded || knownVersions.count(versionName);
+  }
+  // None of them is on disk: the first version found stands in
+  if (!preload.isEmpty() && !preloaded && !knownVersions.empty())
+    requestVersion(knownVersions.begin()->first);
+  if (pendingLoads.empty())
+    emit bibleLoaded(); // Nothing to wait for
+}
+
+std::map<QString, QString> BibleManager::scanBibleDir() const {
   QDir dir(bibleDir);
   QStringList filters;
   filters << "*.xml";
   dir.setNameFilters(filters);
 
-  QStringList files = dir.entryList(QDir::Files);
-  for (const QString &file : files) {
+  std::map<QString, QString> found;
+  for (const QString &file : dir.entryList(QDir::Files)) {
     QString versionName = QFileInfo(file).baseName(); // e.g., "NKJV"
-    parseXML(dir.absoluteFilePath(file), versionName);
+    found.emplace(versionName, dir.absoluteFilePath(file));
   }
+  return found;
+}
+
+void BibleManager::rescanBibles() {
+  const std::map<QString, QString> found = scanBibleDir();
+  bool changed = false;
 
-  if (versions.empty()) {
-    qWarning() << "No Bible versions were loaded successfully!";
+  for (auto it = knownVersions.begin(); it != knownVersions.end();) {
+    if (found.count(it->first)) {
+      ++it;
+      continue;
+    }
+    const QString name = it->first;
+    qDebug() << "Bible removed:" << it->second;
+    it = knownVersions.erase(it);
+    changed = true;
+    if (versions.erase(name)) {
+      lastUse.erase(name);
+      publish();
+      dropCached(name);
+      emit versionUnloaded(name);
+    }
   }
 
-  emit bibleLoaded();
+  const QStringList watched = watcher->files();
+  bool retry = false;
+  for (const auto &[name, filePath] : found) {
+    // A file replaced by a rename is no longer watched
+    if (!watched.contains(filePath))
+      watcher->addPath(filePath);
+    if (knownVersions.emplace(name, filePath).second) {
+      qDebug() << "Bible added:" << filePath;
+      changed = true;
+      continue;
+    }
+    if (!changedFiles.count(filePath))
+      continue;
+    if (pendingLoads.count(name)) {
+      // It may have read the file before the change; load it again after
+      retry = true;
+      continue;
+    }
+    changedFiles.erase(filePath);
+    // Versions not loaded read the new file when they are
+    if (versions.count(name)) {
+      qDebug() << "Bible changed, reloading:" << filePath;
+      startLoad(name, filePath);
+    }
+  }
+  if (retry)
+    rescanTimer->start();
+  else
+    changedFiles.clear();
+  if (changed)
+    emit versionsChanged();
 }
 
-void BibleManager::parseXML(const QString &filePath,
-                            const QString &versionName) {
-  QFile file(filePath);
-  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-    qWarning() << "Failed to open Bible XML:" << filePath;
+void BibleManager::requestVersion(const QString &version) {
+  auto file = knownVersions.find(version);
+  if (file == knownVersions.end() || versions.count(version) ||
+      pendingLoads.count(version))
     return;
+  startLoad(version, file->second);
+}
+
+void BibleManager::startLoad(const QString &versionName,
+                             const QString &filePath) {
+  if (pendingLoads.empty())
+    loadsFinished = loadsTotal = 0;
+  ++loadsTotal;
+
+  auto load = std::make_shared<PendingLoad>();
+  pendingLoads[versionName] = load;
+  loaderPool->start([this, filePath, versionName, load]() {
+    load->data = buildVersion(filePath, versionName);
+    QMetaObject::invokeMethod(
+        this,
+        [this, versionName, load]() { finishVersion(versionName, load); },
+        Qt::QueuedConnection);
+  });
+}
+
+std::shared_ptr<const BibleManager::VersionMap>
+BibleManager::snapshot() const {
+  return std::atomic_load_explicit(&published, std::memory_order_acquire);
+}
+
+void BibleManager::publish() {
+  std::atomic_store_explicit(&published,
+                             std::make_shared<const VersionMap>(versions),
+                             std::memory_order_release);
+}
+
+std::shared_ptr<const BibleManager::BibleData>
+BibleManager::acquire(const QString &version) {
+  if (QThread::currentThread() != thread()) {
+    const std::shared_ptr<const VersionMap> loaded = snapshot();
+    auto it = loaded->find(version);
+    if (it != loaded->end())
+      return it->second;
+    QMetaObject::invokeMethod(
+        this, [this, version]() { requestVersion(version); },
+        Qt::QueuedConnection);
+    return nullptr;
   }
 
-  QXmlStreamReader xml(&file);
-  QString currentBook;
-  int currentChapter = 0;
-  int depth = 0;
+  auto it = versions.find(version);
+  if (it == versions.end()) {
+    // Never load on the GUI thread: callers show the version once
+    // versionLoaded announces it
+    requestVersion(version);
+    return nullptr;
+  }
+  lastUse[version] = ++useClock;
+  return it->second;
+}
 
-  BibleData &data = versions[versionName];
+std::shared_ptr<BibleManager::BibleData>
+BibleManager::buildVersion(const QString &filePath,
+                           const QString &versionName) {
+  std::unique_ptr<BibleStore> store = BibleCache::load(filePath, versionName);
+  if (!store) {
+    qWarning() << "Failed to load Bible:" << filePath;
+    return nullptr;
+  }
 
-  while (!xml.atEnd() && !xml.hasError()) {
-    QXmlStreamReader::TokenType token = xml.readNext();
+  auto data = std::make_shared<BibleData>();
+  data->bookKeys.resize(store->bookCount());
+  for (int book = 1; book <= store->bookCount(); ++book) {
+    auto [first, last] = store->bookRange(book);
+    if (first == last)
+      continue;
+    QString originalName = store->bookName(book);
+    QString normalized =
+        book <= Bible::kCanonicalBookCount
+            ? QString(Bible::kCanonicalBooks[book - 1].name)
+            : normalizeBookName(originalName);
+    data->books.emplace(normalized, book);
+    data->bookKeys[book - 1] = normalized;
+    // Store localized name mapping: Normalized -> Original
+    // "Genesis" -> "Mwanzo"
+    data->displayNames[normalized] = originalName;
+    if (book <= Bible::kCanonicalBookCount) {
+      data->canonicalBooks.push_back(
+          {originalName, Bible::kCanonicalBooks[book - 1].testament,
+           store->chapterCount(book), book, last - first});
+    }
+  }
+  data->index = BibleIndex::build(*store);
+  data->spelling = BibleSpelling::build(*data->index);
+  data->name = versionName;
+  data->alignment = Bible::VerseAlignment::build(*store);
+  data->store = std::move(store);
 
-    if (token == QXmlStreamReader::StartElement) {
-      QString name = xml.name().toString();
+  const MemoryUsage memory = memoryUsage(*data);
+  qDebug() << "Loaded Bible:" << versionName << "with" << data->books.size()
+           << "books," << memory.heap() / 1024 << "KiB +"
+           << memory.image / 1024 << "KiB mapped";
+  return data;
+}
 
-      if (name == "b") {
-        QString originalName = xml.attributes().value("n").toString();
-        currentBook = normalizeBookName(originalName);
-        // Store localized name mapping: Normalized -> Original
-        // "Genesis" -> "Mwanzo"
-        data.displayNames[currentBook] = originalName;
-      } else if (name == "c") {
-        currentChapter = xml.attributes().value("n").toInt();
-      } else if (name == "v") {
-        int verseNum = xml.attributes().value("n").toInt();
-        QString text = xml.readElementText();
-        data.content[currentBook][currentChapter][verseNum] = text;
-      }
+const BibleCorpus &BibleManager::BibleData::corpus() const {
+  std::lock_guard<std::mutex> lock(corpusMutex);
+  if (!lazyCorpus)
+    lazyCorpus = BibleCorpus::build(*store);
+  return *lazyCorpus;
+}
+
+const BibleCorpus *BibleManager::BibleData::builtCorpus() const {
+  std::lock_guard<std::mutex> lock(corpusMutex);
+  return lazyCorpus.get();
+}
+
+BibleManager::MemoryUsage BibleManager::memoryUsage(const BibleData &data) {
+  MemoryUsage usage;
+  usage.image = data.store->imageSize();
+  usage.mapped = data.store->isMapped();
+  usage.tables = data.store->tableBytes() + data.alignment.memoryBytes();
+  usage.index = data.index->memoryBytes() + data.spelling->memoryBytes();
+  if (const BibleCorpus *corpus = data.builtCorpus())
+    usage.corpus = corpus->memoryBytes();
+  return usage;
+}
+
+BibleManager::MemoryUsage
+BibleManager::getMemoryUsage(const QString &version) const {
+  const std::shared_ptr<const VersionMap> loaded = snapshot();
+  auto it = loaded->find(version);
+  return it != loaded->end() ? memoryUsage(*it->second) : MemoryUsage();
+}
+
+void BibleManager::finishVersion(const QString &versionName,
+                                 const std::shared_ptr<PendingLoad> &load) {
+  auto it = pendingLoads.find(versionName);
+  if (it == pendingLoads.end() || it->second != load)
+    return; // Superseded by a later load of the version
+  pendingLoads.erase(it);
+  ++loadsFinished;
+  addVersion(versionName, load->data);
+  emit loadProgress(loadsFinished, loadsTotal);
+
+  if (pendingLoads.empty()) {
+    if (versions.empty()) {
+      qWarning() << "No Bible versions were loaded successfully!";
     }
+    emit bibleLoaded();
   }
+}
 
-  if (xml.hasError()) {
-    qWarning() << "XML Parse Error in" << filePath << ":" << xml.errorString();
-  } else {
-    qDebug() << "Loaded Bible:" << versionName << "with" << data.content.size()
-             << "books";
+void BibleManager::addVersion(const QString &versionName,
+                              std::shared_ptr<const BibleData> data) {
+  if (!data) {
+    if (versions.count(versionName)) {
+      qWarning() << "Keeping the loaded" << versionName
+                 << "Bible until its file loads again";
+      return;
+    }
+    knownVersions.erase(versionName);
+    return;
   }
+  if (!knownVersions.count(versionName))
+    return; // Removed while it loaded
+  // Searches running meanwhile keep the data they started with
+  versions[versionName] = std::move(data);
+  lastUse[versionName] = ++useClock;
+  publish();
+  dropCached(versionName);
+  enforceBudget();
+  emit versionLoaded(versionName);
+}
+
+void BibleManager::setMemoryBudget(qint64 bytes) {
+  budget = bytes;
+  enforceBudget();
+}
+
+void BibleManager::enforceBudget() {
+  qint64 total = 0;
+  for (const auto &[name, data] : versions)
+    total += memoryUsage(*data).total();
+  while (total > budget && versions.size() > 1) {
+    // The least recently used version; the most recent one is never picked
+    // as at least one other is older
+    auto victim = versions.begin();
+    for (auto it = versions.begin(); it != versions.end(); ++it) {
+      if (lastUse[it->first] < lastUse[victim->first])
+        victim = it;
+    }
+    const QString name = victim->first;
+    total -= memoryUsage(*victim->second).total();
+    versions.erase(victim);
+    lastUse.erase(name);
+    publish();
+    dropCached(name);
+    qDebug() << "Unloaded Bible:" << name << "to stay within"
+             << budget / (1024 * 1024) << "MiB";
+    emit versionUnloaded(name);
+  }
+}
+
+int BibleManager::findBook(const BibleData &data, const QString &book) {
+  auto it = data.books.find(book);
+  if (it == data.books.end())
+    it = data.books.find(normalizeBookName(book));
+  return it != data.books.end() ? it->second : 0;
 }
 
-// Helper to normalize book names
 QString BibleManager::normalizeBookName(const QString &input) {
-  static const std::map<QString, QString> bookMap = {
-      {"gen", "Genesis"},
-      {"genesis", "Genesis"},
-      {"exo", "Exodus"},
-      {"exodus", "Exodus"},
-      {"lev", "Leviticus"},
-      {"leviticus", "Leviticus"},
-      {"num", "Numbers"},
-      {"numbers", "Numbers"},
-      {"deu", "Deuteronomy"},
-      {"deuteronomy", "Deuteronomy"},
-      {"jos", "Joshua"},
-      {"joshua", "Joshua"},
-      {"jdg", "Judges"},
-      {"judges", "Judges"},
-      {"rut", "Ruth"},
-      {"ruth", "Ruth"},
-      {"1sa", "1 Samuel"},
-      {"1 samuel", "1 Samuel"},
-      {"2sa", "2 Samuel"},
-      {"2 samuel", "2 Samuel"},
-      {"1ki", "1 Kings"},
-      {"1 kings", "1 Kings"},
-      {"2ki", "2 Kings"},
-      {"2 kings", "2 Kings"},
-      {"1ch", "1 Chronicles"},
-      {"1 chronicles", "1 Chronicles"},
-      {"2ch", "2 Chronicles"},
-      {"2 chronicles", "2 Chronicles"},
-      {"ezr", "Ezra"},
-      {"ezra", "Ezra"},
-      {"neh", "Nehemiah"},
-      {"nehemiah", "Nehemiah"},
-      {"est", "Esther"},
-      {"esther", "Esther"},
-      {"job", "Job"},
-      {"ps", "Psalms"},
-      {"psa", "Psalms"},
-      {"psalm", "Psalms"},
-      {"psalms", "Psalms"},
-      {"pro", "Proverbs"},
-      {"proverbs", "Proverbs"},
-      {"ecc", "Ecclesiastes"},
-      {"ecclesiastes", "Ecclesiastes"},
-      {"son", "Song of Solomon"},
-      {"song", "Song of Solomon"},
-      {"isa", "Isaiah"},
-      {"isaiah", "Isaiah"},
-      {"jer", "Jeremiah"},
-      {"jeremiah", "Jeremiah"},
-      {"lam", "Lamentations"},
-      {"lamentations", "Lamentations"},
-      {"eze", "Ezekiel"},
-      {"ezekiel", "Ezekiel"},
-      {"dan", "Daniel"},
-      {"daniel", "Daniel"},
-      {"hos", "Hosea"},
-      {"hosea", "Hosea"},
-      {"joe", "Joel"},
-      {"joel", "Joel"},
-      {"amo", "Amos"},
-      {"amos", "Amos"},
-      {"oba", "Obadiah"},
-      {"obadiah", "Obadiah"},
-      {"jon", "Jonah"},
-      {"jonah", "Jonah"},
-      {"mic", "Micah"},
-      {"micah", "Micah"},
-      {"nah", "Nahum"},
-      {"nahum", "Nahum"},
-      {"hab", "Habakkuk"},
-      {"habakkuk", "Habakkuk"},
-      {"zep", "Zephaniah"},
-      {"zephaniah", "Zephaniah"},
-      {"hag", "Haggai"},
-      {"haggai", "Haggai"},
-      {"zec", "Zechariah"},
-      {"zechariah", "Zechariah"},
-      {"mal", "Malachi"},
-      {"malachi", "Malachi"},
-      {"mat", "Matthew"},
-      {"matt", "Matthew"},
-      {"matthew", "Matthew"},
-      {"mar", "Mark"},
-      {"mark", "Mark"},
-      {"luk", "Luke"},
-      {"luke", "Luke"},
-      {"joh", "John"},
-      {"john", "John"},
-      {"act", "Acts"},
-      {"acts", "Acts"},
-      {"rom", "Romans"},
-      {"romans", "Romans"},
-      {"1co", "1 Corinthians"},
-      {"1 corinthians", "1 Corinthians"},
-      {"2co", "2 Corinthians"},
-      {"2 corinthians", "2 Corinthians"},
-      {"gal", "Galatians"},
-      {"galatians", "Galatians"},
-      {"eph", "Ephesians"},
-      {"ephesians", "Ephesians"},
-      {"phi", "Philippians"},
-      {"philippians", "Philippians"},
-      {"col", "Colossians"},
-      {"colossians", "Colossians"},
-      {"1th", "1 Thessalonians"},
-      {"1 thessalonians", "1 Thessalonians"},
-      {"2th", "2 Thessalonians"},
-      {"2 thessalonians", "2 Thessalonians"},
-      {"1ti", "1 Timothy"},
-      {"1 timothy", "1 Timothy"},
-      {"2ti", "2 Timothy"},
-      {"2 timothy", "2 Timothy"},
-      {"tit", "Titus"},
-      {"titus", "Titus"},
-      {"phm", "Philemon"},
-      {"philemon", "Philemon"},
-      {"heb", "Hebrews"},
-      {"hebrews", "Hebrews"},
-      {"jam", "James"},
-      {"james", "James"},
-      {"1pe", "1 Peter"},
-      {"1 peter", "1 Peter"},
-      {"2pe", "2 Peter"},
-      {"2 peter", "2 Peter"},
-      {"1jo", "1 John"},
-      {"1 john", "1 John"},
-      {"2jo", "2 John"},
-      {"2 john", "2 John"},
-      {"3jo", "3 John"},
-      {"3 john", "3 John"},
-      {"jud", "Jude"},
-      {"jude", "Jude"},
-      // Common Abbreviations for numbered books
-      {"sam", "1 Samuel"},
-      {"samuel", "1 Samuel"},
-      {"1sam", "1 Samuel"},
-      {"2sam", "2 Samuel"},
-      {"kin", "1 Kings"},
-      {"kings", "1 Kings"},
-      {"1kings", "1 Kings"},
-      {"2kings", "2 Kings"},
-      {"chr", "1 Chronicles"},
-      {"chronicles", "1 Chronicles"},
-      {"1chron", "1 Chronicles"},
-      {"2chron", "2 Chronicles"},
-      {"cor", "1 Corinthians"},
-      {"cori", "1 Corinthians"},
-      {"corinthians", "1 Corinthians"},
-      {"1cor", "1 Corinthians"},
-      {"2cor", "2 Corinthians"},
-      {"thess", "1 Thessalonians"},
-      {"thessalonians", "1 Thessalonians"},
-      {"1thess", "1 Thessalonians"},
-      {"2thess", "2 Thessalonians"},
-      {"tim", "1 Timothy"},
-      {"timothy", "1 Timothy"},
-      {"1tim", "1 Timothy"},
-      {"2tim", "2 Timothy"},
-      {"pet", "1 Peter"},
-      {"peter", "1 Peter"},
-      {"1pet", "1 Peter"},
-      {"2pet", "2 Peter"},
-      {"joh", "John"}, // Ambiguous, but usually Gospel
-      {"john", "John"},
-      {"1john", "1 John"},
-      {"2john", "2 John"},
-      {"3john", "3 John"},
-      {"1joh", "1 John"},
-      {"2joh", "2 John"},
-      {"3joh", "3 John"},
-      {"rev", "Revelation"},
-      {"revelation", "Revelation"},
-      // Swahili normalization
-      {"gen", "Genesis"}, // Valid in Swahili context too if mixed
-      {"mwanzo", "Genesis"},
-      {"mwan", "Genesis"}, // Swahili Abbrev
-      {"kutoka", "Exodus"},
-      {"kut", "Exodus"}, // Swahili Abbrev
-      {"walawi", "Leviticus"},
-      {"wal", "Leviticus"},
-      {"hesabu", "Numbers"},
-      {"hes", "Numbers"},
-      {"kumbukumbu", "Deuteronomy"},
-      {"kum", "Deuteronomy"},
-      {"kumbukumbu la torati", "Deuteronomy"},
-      {"yoshua", "Joshua"},
-      {"yos", "Joshua"},
-      {"waamuzi", "Judges"},
-      {"waa", "Judges"},
-      {"rutu", "Ruth"},
-      {"rut", "Ruth"}, // Overlaps with English Ruth? "rut" -> Ruth. Fine.
-      {"1 samweli", "1 Samuel"},
-      {"1samweli", "1 Samuel"},
-      {"1sam", "1 Samuel"}, // Swahili speakers use English abbrevs too
-      {"2 samweli", "2 Samuel"},
-      {"2samweli", "2 Samuel"},
-      {"1 wafalme", "1 Kings"},
-      {"1waf", "1 Kings"},
-      {"1wafalme", "1 Kings"},
-      {"2 wafalme", "2 Kings"},
-      {"2waf", "2 Kings"},
-      {"2wafalme", "2 Kings"},
-      {"1 mambo ya nyakati", "1 Chronicles"},
-      {"1mambo", "1 Chronicles"},
-      {"2 mambo ya nyakati", "2 Chronicles"},
-      {"2mambo", "2 Chronicles"},
-      {"ezra", "Ezra"},
-      {"ezr", "Ezra"},
-      {"nehemia", "Nehemiah"},
-      {"neh", "Nehemiah"},
-      {"esta", "Esther"},
-      {"est", "Esther"},
-      {"ayubu", "Job"},
-      {"ayu", "Job"},
-      {"zaburi", "Psalms"},
-      {"zab", "Psalms"},
-      {"mithali", "Proverbs"},
-      {"mit", "Proverbs"},
-      {"mhubiri", "Ecclesiastes"},
-      {"mhu", "Ecclesiastes"},
-      {"wimbo ulio bora", "Song of Solomon"},
-      {"wim", "Song of Solomon"},
-      {"isaya", "Isaiah"},
-      {"isa", "Isaiah"},
-      {"yeremia", "Jeremiah"},
-      {"yer", "Jeremiah"},
-      {"maombolezo", "Lamentations"},
-      {"mao", "Lamentations"},
-      {"ezekieli", "Ezekiel"},
-      {"eze", "Ezekiel"},
-      {"danieli", "Daniel"},
-      {"dan", "Daniel"},
-      {"hotea", "Hosea"}, // Correct spelling? Hosea in Swahili is "Hosea"
-                          // usually? XML check needed. Assuming "Hosea" or
-                          // "Hosea". User code had "hotea"?
-      {"hosea", "Hosea"},
-      {"hos", "Hosea"},
-      {"yoeli", "Joel"},
-      {"yoe", "Joel"},
-      {"amosi", "Amos"},
-      {"amo", "Amos"},
-      {"obadia", "Obadiah"},
-      {"oba", "Obadiah"},
-      {"yona", "Jonah"},
-      {"yon", "Jonah"},
-      {"mika", "Micah"},
-      {"mik", "Micah"},
-      {"nahumu", "Nahum"},
-      {"nah", "Nahum"},
-      {"habakuki", "Habakkuk"},
-      {"hab", "Habakkuk"},
-      {"sefania", "Zephaniah"},
-      {"sef", "Zephaniah"},
-      {"hagai", "Haggai"},
-      {"hag", "Haggai"},
-      {"zakaria", "Zechariah"},
-      {"zak", "Zechariah"},
-      {"malaki", "Malachi"},
-      {"mal", "Malachi"},
-      {"mathayo", "Matthew"},
-      {"mat", "Matthew"},
-      {"marko", "Mark"},
-      {"mar", "Mark"},
-      {"luka", "Luke"},
-      {"luk", "Luke"},
-      {"yohana", "John"},
-      {"yoh", "John"},
-      {"matendo", "Acts"},
-      {"mat", "Acts"}, // Conflict with Matthew? "mat" usually Matt. "matendo"
-                       // -> Acts. Maybe "mitume"?
-      {"matendo ya mitume", "Acts"},
-      {"warumi", "Romans"},
-      {"war", "Romans"},
-      {"1 wakorintho", "1 Corinthians"},
-      {"1wak", "1 Corinthians"},
-      {"2 wakorintho", "2 Corinthians"},
-      {"2wak", "2 Corinthians"},
-      {"wagalatia", "Galatians"},
-      {"wag", "Galatians"},
-      {"waefeso", "Ephesians"},
-      {"waef", "Ephesians"},
-      {"wafilipi", "Philippians"},
-      {"waf", "Philippians"},
-      {"wakolosai", "Colossians"},
-      {"wak", "Colossians"},
-      {"1 wathesalonike", "1 Thessalonians"},
-      {"1wat", "1 Thessalonians"},
-      {"2 wathesalonike", "2 Thessalonians"},
-      {"2wat", "2 Thessalonians"},
-      {"1 timotheo", "1 Timothy"},
-      {"1tim", "1 Timothy"},
-      {"2 timotheo", "2 Timothy"},
-      {"2tim", "2 Timothy"},
-      {"tito", "Titus"},
-      {"tito", "Titus"}, // Same
-      {"filemoni", "Philemon"},
-      {"fil", "Philemon"},
-      {"waebrania", "Hebrews"},
-      {"wae", "Hebrews"},
-      {"yakobo", "James"},
-      {"yak", "James"},
-      {"1 petro", "1 Peter"},
-      {"1pet", "1 Peter"},
-      {"2 petro", "2 Peter"},
-      {"2pet", "2 Peter"},
-      {"1 yohana", "1 John"},
-      {"1yoh", "1 John"},
-      {"2 yohana", "2 John"},
-      {"2yoh", "2 John"},
-      {"3 yohana", "3 John"},
-      {"3yoh", "3 John"},
-      {"yuda", "Jude"},
-      {"yud", "Jude"},
-      {"ufunuo", "Revelation"},
-      {"ufu", "Revelation"},
-      {"ufunuo wa yohana", "Revelation"}};
-
-  QString lower = input.toLower().remove('.');
-  // Try strict match
-  if (bookMap.count(lower))
-    return bookMap.at(lower);
-
-  // Try prefix match if len >= 2
-  if (lower.length() >= 2) {
-    for (const auto &[key, val] : bookMap) {
-      if (key.startsWith(lower))
-        return val;
+  const Bible::BookLookup found = Bible::lookupBookName(input);
+  if (found.book > 0)
+    return QString::fromLatin1(Bible::kCanonicalBooks[found.book - 1].name);
+  return input; // Unknown, or the start of several books' names
+}
+
+std::vector<BibleVerse>
+BibleManager::search(const QString &query, const QString &version,
+                     std::shared_ptr<SearchCursor> *cursor) {
+  if (!version.isEmpty())
+    acquire(version);
+  std::shared_ptr<SearchCursor> ranked; // Highlights keyword hits
+  const std::vector<VerseView> views =
+      searchCached(*snapshot(), query, version, &ranked, nullptr);
+  std::vector<BibleVerse> results = toVerses(views, ranked.get());
+  if (cursor)
+    *cursor = std::move(ranked);
+  return results;
+}
+
+std::vector<BibleManager::VerseView>
+BibleManager::searchViews(const QString &query, const QString &version,
+                          std::shared_ptr<SearchCursor> *cursor) {
+  if (!version.isEmpty())
+    acquire(version);
+  return searchCached(*snapshot(), query, version, cursor, nullptr);
+}
+
+std::vector<BibleManager::VerseView>
+BibleManager::searchCached(const VersionMap &snapshot, const QString &query,
+                           const QString &version,
+                           std::shared_ptr<SearchCursor> *cursor,
+                           const SearchToken *token) {
+  // The versions searchVersions() searches
+  std::vector<std::shared_ptr<const BibleData>> searched;
+  auto it = snapshot.find(version);
+  if (it != snapshot.end()) {
+    searched.push_back(it->second);
+  } else {
+    for (const auto &[name, data] : snapshot)
+      searched.push_back(data);
+  }
+
+  // Whitespace inside the query is one space, but a space ending it closes
+  // the last word or phrase (see BibleQuery), so "love " is not "love"
+  QString simplified = query.simplified();
+  if (!simplified.isEmpty() && query.back().isSpace())
+    simplified += ' ';
+  const SearchKey key{version, simplified};
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    const CachedSearch *cached = searchCache.find(key);
+    if (cached && cached->data == searched) {
+      if (cursor) {
+        *cursor = cached->cursor
+                      ? std::make_shared<SearchCursor>(*cached->cursor)
+                      : nullptr;
+      }
+      return cached->views;
     }
   }
-  return input; // Return original if no match
+
+  std::shared_ptr<SearchCursor> ranked;
+  std::vector<VerseView> views =
+      searchVersions(snapshot, query, version, &ranked, token);
+  if (token && token->isCanceled())
+    return views; // Partial
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    searchCache.insert(
+        key, {std::move(searched), views,
+              ranked ? std::make_shared<const SearchCursor>(*ranked)
+                     : nullptr});
+  }
+  if (cursor)
+    *cursor = std::move(ranked);
+  return views;
+}
+
+void BibleManager::dropCached(const QString &version) {
+  // Searches of every version depend on each of them
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  searchCache.removeIf([&](const SearchKey &key, const CachedSearch &cached) {
+    if (key.first == version || key.first.isEmpty())
+      return true;
+    // A version searched in place of one not loaded yet: the entry would
+    // keep its old data alive
+    return std::any_of(cached.data.begin(), cached.data.end(),
+                       [&](const std::shared_ptr<const BibleData> &data) {
+                         auto it = versions.find(data->name);
+                         return it == versions.end() || it->second != data;
+                       });
+  });
 }
 
-std::vector<BibleVerse> BibleManager::search(const QString &query,
-                                             const QString &version) {
-  std::vector<BibleVerse> results;
-  if (versions.empty())
+BibleManager::CacheStats BibleManager::getSearchCacheStats() const {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return {searchCache.hits(), searchCache.misses(), searchCache.size()};
+}
+
+std::shared_ptr<BibleManager::SearchToken>
+BibleManager::searchAsync(const QString &query, const QString &version,
+                          QObject *receiver, SearchHandler handler,
+                          std::shared_ptr<SearchSession> *session) {
+  if (!version.isEmpty())
+    acquire(version); // Before the snapshot below
+  auto token = std::make_shared<SearchToken>();
+  std::shared_ptr<SearchToken> &active = activeSearches[receiver];
+  if (active)
+    active->cancel();
+  active = token;
+
+  std::shared_ptr<SearchSession> state;
+  if (session) {
+    if (!*session)
+      *session = std::make_shared<SearchSession>();
+    state = *session;
+  }
+
+  // Batches are posted to this object and dropped on the GUI thread if the
+  // search was canceled meanwhile, so cancel() takes effect immediately
+  QPointer<QObject> guard(receiver);
+  auto deliver = [this, token, guard, receiver, handler](SearchBatch batch) {
+    QMetaObject::invokeMethod(
+        this,
+        [this, token, guard, receiver, handler, batch]() {
+          if (token->isCanceled())
+            return;
+          if (batch.last) {
+            auto it = activeSearches.find(receiver);
+            if (it != activeSearches.end() && it->second == token)
+              activeSearches.erase(it);
+          }
+          if (guard)
+            handler(batch);
+        },
+        Qt::QueuedConnection);
+  };
+
+  searchPool->start([this, loaded = snapshot(), query, version, state, token,
+                     deliver]() {
+    if (token->isCanceled())
+      return;
+    std::shared_ptr<SearchCursor> cursor;
+    const std::vector<VerseView> results =
+        state ? searchIncremental(*state, *loaded, query, version, &cursor,
+                                  token.get())
+              : searchCached(*loaded, query, version, &cursor, token.get());
+
+    // Small batches keep the GUI thread responsive while it builds the items
+    size_t next = 0;
+    do {
+      if (token->isCanceled())
+        return;
+      SearchBatch batch;
+      const size_t end = std::min(results.size(), next + kSearchBatchSize);
+      batch.verses = toVerses(
+          std::vector<VerseView>(results.begin() + next, results.begin() + end),
+          cursor.get());
+      batch.first = next == 0;
+      batch.last = end == results.size();
+      if (batch.last)
+        batch.cursor = cursor;
+      next = end;
+      deliver(std::move(batch));
+    } while (next < results.size());
+  });
+  return token;
+}
+
+std::vector<BibleManager::VerseView>
+BibleManager::searchVersions(const VersionMap &snapshot, const QString &query,
+                             const QString &version,
+                             std::shared_ptr<SearchCursor> *cursor,
+                             const SearchToken *token) {
+  if (cursor)
+    cursor->reset();
+  std::vector<VerseView> results;
+  if (snapshot.empty())
     return results;
+  auto canceled = [token] { return token && token->isCanceled(); };
 
   // Filter versions to search
   std::vector<QString> versionsToSearch;
-  if (!version.isEmpty() && versions.count(version)) {
+  if (!version.isEmpty() && snapshot.count(version)) {
     versionsToSearch.push_back(version);
   } else {
-    for (const auto &[name, data] : versions) {
+    for (const auto &[name, data] : snapshot) {
       versionsToSearch.push_back(name);
     }
   }
 
-  // 1. Try parsing as Reference: "Book Chapter:Verse" or "Book
-  // Chapter:Verse-Verse" Flexible Regex: Group 1: Book name, Group 2: Chapter,
-  // Group 3: Start Verse, Group 4: End Verse
-  QRegularExpression refRegex(
-      R"(^([1-3]?\s*[a-zA-Z\x80-\xff\.]+)\s*(\d*)\s*[:\s]?\s*(\d*)?\s*-?\s*(\d*)?$)");
-  QRegularExpressionMatch match = refRegex.match(query.trimmed());
+  // 1. Try parsing as a reference list: "John 3:16-18, 4:1; Ps 23"
+  std::vector<Bible::VerseRange> ranges;
+  if (Bible::parseReferences(query, ranges)) {
+    for (const QString &verName : versionsToSearch)
+      appendReferences(snapshot.at(verName), ranges, results);
+  }
+
+  // 2. Fallback: Keyword search
+  // Only if no results found above AND query looks like a keyword (not a failed
+  // reference)
+  if (results.empty() && query.length() > 3) {
+    auto ranked = std::make_shared<SearchCursor>();
+    ranked->query = BibleQuery::parse(query);
+    for (const QString &verName : versionsToSearch) {
+      ranked->versions.push_back(verName);
+      ranked->data.push_back(snapshot.at(verName));
+    }
+
+    // One version per shard, evaluated in parallel
+    const int count = int(ranked->data.size());
+    std::vector<std::vector<BibleQuery::Scored>> scored(
+        static_cast<size_t>(count));
+    runShards(count, [&](int v) {
+      if (canceled())
+        return false;
+      scored[size_t(v)] = ranked->query.rank(*ranked->data[size_t(v)]->index);
+      return true;
+    });
+    if (canceled())
+      return results;
+    for (int v = 0; v < count; ++v) {
+      for (const BibleQuery::Scored &hit : scored[size_t(v)])
+        ranked->hits.push_back({hit.score, v, hit.verse});
+    }
+    if (ranked->hits.empty() && !findSubstring(*ranked, query, token))
+      return results;
+    if (ranked->hits.empty() && !findRespelled(*ranked, token))
+      return results;
+    if (canceled())
+      return results;
+    results = fetchViews(ranked);
+    if (cursor)
+      *cursor = std::move(ranked);
+  }
 
-  if (match.hasMatch()) {
-    QString rawBook = match.captured(1).trimmed();
-    QString book = normalizeBookName(rawBook);
+  return results;
+}
 
-    int chapter = match.captured(2).toInt();    // 0 if empty
-    int startVerse = match.captured(3).toInt(); // 0 if empty
-    int endVerse = match.captured(4).toInt();   // 0 if empty
+bool BibleManager::findSubstring(SearchCursor &cursor, const QString &query,
+                                 const SearchToken *token) {
+  cursor.substring = BibleCorpus::fold(query.trimmed());
 
-    for (const QString &verName : versionsToSearch) {
-      const auto &data = versions[verName];
-      QString targetBook = "";
-      for (const auto &[bKey, val] : data.content) {
-        if (bKey.compare(book, Qt::CaseInsensitive) == 0) {
-          targetBook = bKey;
-          break;
-        }
+  // Shards of whole books, about kSubstringShardVerses verses each, in
+  // version, then canonical, order
+  struct Shard {
+    int version;
+    int first;
+    int last;
+  };
+  std::vector<Shard> shards;
+  for (size_t v = 0; v < cursor.data.size(); ++v) {
+    const BibleStore &store = *cursor.data[v]->store;
+    int first = 0;
+    for (int book = 1; book <= store.bookCount(); ++book) {
+      const int last = store.bookRange(book).second;
+      if (last - first >= kSubstringShardVerses) {
+        shards.push_back({int(v), first, last});
+        first = last;
       }
+    }
+    if (first < store.verseCount())
+      shards.push_back({int(v), first, store.verseCount()});
+  }
 
-      if (!targetBook.isEmpty()) {
-        const auto &chapterData = data.content.at(targetBook);
-        if (chapter > 0) {
-          if (chapterData.count(chapter)) {
-            const auto &versesMap = chapterData.at(chapter);
-            if (startVerse > 0) {
-              int finalEnd = (endVerse > 0) ? endVerse : startVerse;
-              for (int v = startVerse; v <= finalEnd; ++v) {
-                if (versesMap.count(v)) {
-                  results.push_back(
-                      {targetBook, chapter, v, versesMap.at(v), verName});
-                }
-              }
-            } else {
-              for (const auto &[vNum, txt] : versesMap) {
-                results.push_back({targetBook, chapter, vNum, txt, verName});
-                if (results.size() >= 50)
-                  break;
-              }
-            }
-          }
-        } else {
-          // No chapter, default to Ch 1
-          if (chapterData.count(1)) {
-            const auto &versesMap = chapterData.at(1);
-            int count = 0;
-            for (const auto &[vNum, txt] : versesMap) {
-              results.push_back({targetBook, 1, vNum, txt, verName});
-              if (++count >= 20 || results.size() >= 50)
-                break;
-            }
-          }
-        }
+  // Shards are handed out in order, so once the finished ones hold
+  // kMaxSubstringVerses hits, the shards not started yet cannot contribute
+  // to the first kMaxSubstringVerses in canonical order
+  std::vector<std::vector<quint32>> found(shards.size());
+  std::atomic<qsizetype> budget{qsizetype(kMaxSubstringVerses)};
+  runShards(int(shards.size()), [&](int i) {
+    if (token && token->isCanceled())
+      return false;
+    const Shard &shard = shards[size_t(i)];
+    std::vector<quint32> &verses = found[size_t(i)];
+    verses = cursor.data[size_t(shard.version)]->corpus().find(
+        cursor.substring, shard.first, shard.last, kMaxSubstringVerses);
+    const qsizetype n = qsizetype(verses.size());
+    return budget.fetch_sub(n, std::memory_order_relaxed) - n > 0;
+  });
+  if (token && token->isCanceled())
+    return false;
+
+  // No score: hits come in version, then canonical, order
+  for (size_t i = 0; i < shards.size(); ++i) {
+    for (quint32 verse : found[i]) {
+      if (cursor.hits.size() == kMaxSubstringVerses)
+        return true;
+      cursor.hits.push_back({0.0f, shards[i].version, verse});
+    }
+  }
+  return true;
+}
+
+bool BibleManager::findRespelled(SearchCursor &cursor,
+                                 const SearchToken *token) {
+  std::map<std::string, std::vector<std::string>> spellings;
+  for (const std::shared_ptr<const BibleData> &data : cursor.data) {
+    const BibleIndex &index = *data->index;
+    for (const std::string &word : cursor.query.unknownWords(index)) {
+      std::vector<std::string> &found = spellings[word];
+      for (int t : data->spelling->suggest(QByteArrayView(word),
+                                           kMaxSpellings)) {
+        const std::string term(index.term(t).data(),
+                               size_t(index.term(t).size()));
+        if (found.size() < kMaxSpellings &&
+            std::find(found.begin(), found.end(), term) == found.end())
+          found.push_back(term);
       }
     }
   }
+  if (std::none_of(spellings.begin(), spellings.end(),
+                   [](const auto &entry) { return !entry.second.empty(); }))
+    return true; // Nothing to correct
 
-  // 2. Fallback: Keyword search
-  // Only if no results found above AND query looks like a keyword (not a failed
-  // reference)
+  cursor.query = cursor.query.withAlternatives(spellings);
+  cursor.substring.clear();
+  const int count = int(cursor.data.size());
+  std::vector<std::vector<BibleQuery::Scored>> scored(
+      static_cast<size_t>(count));
+  runShards(count, [&](int v) {
+    if (token && token->isCanceled())
+      return false;
+    scored[size_t(v)] = cursor.query.rank(*cursor.data[size_t(v)]->index);
+    return true;
+  });
+  if (token && token->isCanceled())
+    return false;
+  for (int v = 0; v < count; ++v) {
+    for (const BibleQuery::Scored &hit : scored[size_t(v)])
+      cursor.hits.push_back({hit.score, v, hit.verse});
+  }
+  return true;
+}
+
+void BibleManager::appendReferences(
+    const std::shared_ptr<const BibleData> &data,
+    const std::vector<Bible::VerseRange> &ranges,
+    std::vector<VerseView> &results) {
+  const BibleStore &store = *data->store;
+  for (const Bible::VerseRange &range : ranges) {
+    const int last = store.lowerBound(range.last + 1);
+    for (int i = store.lowerBound(range.first); i < last; ++i) {
+      if (results.size() >= kMaxReferenceVerses)
+        return;
+      results.push_back({data, i});
+    }
+  }
+}
+
+std::vector<BibleManager::VerseView>
+BibleManager::searchIncremental(SearchSession &state,
+                                const VersionMap &snapshot,
+                                const QString &query, const QString &version,
+                                std::shared_ptr<SearchCursor> *cursor,
+                                const SearchToken *token) {
+  auto it = snapshot.find(version);
+  if (it == snapshot.end()) {
+    state = SearchSession();
+    return searchVersions(snapshot, query, version, cursor, token);
+  }
+  if (cursor)
+    cursor->reset();
+  const BibleData &data = *it->second;
+  if (state.version != version || state.data != it->second) {
+    state = SearchSession();
+    state.version = version;
+    state.data = it->second;
+  }
+  std::vector<VerseView> results;
+
+  std::vector<Bible::VerseRange> ranges;
+  if (Bible::parseReferences(query, ranges))
+    appendReferences(it->second, ranges, results);
+
+  // Keywords: a plain word query that keeps every previous word, the last
+  // one perhaps typed further, can only narrow the previous matches, so
+  // only the words that changed are matched and scored again; the rest keep
+  // their per-verse scores from the previous call. Anything else ("grace AN"
+  // becoming "grace AND") is evaluated again.
+  bool hasKeywords = false;
   if (results.empty() && query.length() > 3) {
-    QString lowerQuery = query.toLower();
-    for (const auto &[verName, data] : versions) {
-      for (const auto &[book, chapters] : data.content) {
-        for (const auto &[chapNum, verses] : chapters) {
-          for (const auto &[verseNum, text] : verses) {
-            if (text.toLower().contains(lowerQuery)) {
-              BibleVerse v{book, chapNum, verseNum, text, verName};
-              results.push_back(v);
-              if (results.size() >= 50)
-                return results;
-            }
-          }
+    const BibleIndex &index = *data.index;
+    BibleQuery parsed = BibleQuery::parse(query);
+    const int words = parsed.wordCount();
+    std::vector<quint32> matches;
+    std::vector<std::vector<float>> wordScores(static_cast<size_t>(words));
+    auto frequency = [&](int w) {
+      auto [entry, added] = state.frequencies.try_emplace(parsed.wordKey(w));
+      if (added)
+        entry->second = parsed.wordFrequency(index, w);
+      return entry->second;
+    };
+
+    const int previous = state.hasKeywords ? state.keywords.wordCount() : 0;
+    bool narrow = words > 0 && previous > 0 && words >= previous;
+    for (int w = 0; narrow && w < previous - 1; ++w)
+      narrow = parsed.sameWord(w, state.keywords);
+    narrow = narrow && parsed.narrowsWord(previous - 1, state.keywords);
+
+    if (narrow) {
+      const int stable = parsed.sameWord(previous - 1, state.keywords)
+                             ? previous
+                             : previous - 1;
+      matches = state.matches;
+      for (int w = stable; w < words && !matches.empty(); ++w) {
+        if (token && token->isCanceled())
+          return results; // The session is left as it was
+        matches = parsed.filterWord(index, w, matches);
+      }
+      // Carry over the scores of the unchanged words for the survivors
+      for (int w = 0; w < stable; ++w) {
+        const std::vector<float> &previous = state.wordScores[size_t(w)];
+        size_t j = 0;
+        for (quint32 v : matches) {
+          while (state.matches[j] != v)
+            ++j;
+          wordScores[size_t(w)].push_back(previous[j]);
         }
       }
+      for (int w = stable; w < words; ++w)
+        wordScores[size_t(w)] =
+            parsed.scoreWord(index, w, matches, frequency(w));
+    } else if (words > 0) {
+      matches = parsed.evaluate(index);
+      for (int w = 0; w < words; ++w)
+        wordScores[size_t(w)] =
+            parsed.scoreWord(index, w, matches, frequency(w));
     }
+    if (token && token->isCanceled())
+      return results;
+
+    auto ranked = std::make_shared<SearchCursor>();
+    ranked->versions.push_back(version);
+    ranked->data.push_back(it->second);
+    if (words > 0) {
+      for (size_t i = 0; i < matches.size(); ++i) {
+        float score = 0.0f;
+        for (const std::vector<float> &scores : wordScores)
+          score += scores[i];
+        ranked->hits.push_back({score, 0, matches[i]});
+      }
+    } else {
+      for (const BibleQuery::Scored &hit : parsed.rank(index))
+        ranked->hits.push_back({hit.score, 0, hit.verse});
+    }
+    ranked->query = parsed;
+    if (ranked->hits.empty() && !findSubstring(*ranked, query, token))
+      return results; // The session is left as it was
+    if (ranked->hits.empty() && !findRespelled(*ranked, token))
+      return results; // The session is left as it was
+    results = fetchViews(ranked);
+    if (cursor)
+      *cursor = std::move(ranked);
+
+    state.keywords = std::move(parsed);
+    state.matches = std::move(matches);
+    state.wordScores = std::move(wordScores);
+    hasKeywords = true;
   }
+  state.hasKeywords = hasKeywords;
+  state.query = query;
+  return results;
+}
 
+std::vector<BibleVerse>
+BibleManager::fetchMore(const std::shared_ptr<SearchCursor> &cursor,
+                        int count) {
+  return toVerses(fetchViews(cursor, count), cursor.get());
+}
+
+std::vector<BibleManager::VerseView>
+BibleManager::fetchViews(const std::shared_ptr<SearchCursor> &cursor,
+                         int count) {
+  std::vector<VerseView> results;
+  if (!cursor || count <= 0)
+    return results;
+
+  // Bounded heap of the best hits ranked after the previous page; its top is
+  // the kept hit that ranks last. O(n log count) per page.
+  using Hit = SearchCursor::Hit;
+  std::vector<Hit> heap;
+  heap.reserve(size_t(count));
+  for (const Hit &hit : cursor->hits) {
+    if (cursor->started && !ranksBefore(cursor->last, hit))
+      continue;
+    if (int(heap.size()) < count) {
+      heap.push_back(hit);
+      std::push_heap(heap.begin(), heap.end(), ranksBefore);
+    } else if (ranksBefore(hit, heap.front())) {
+      std::pop_heap(heap.begin(), heap.end(), ranksBefore);
+      heap.back() = hit;
+      std::push_heap(heap.begin(), heap.end(), ranksBefore);
+    }
+  }
+  std::sort_heap(heap.begin(), heap.end(), ranksBefore);
+  if (heap.empty())
+    return results;
+  cursor->last = heap.back();
+  cursor->started = true;
+
+  results.reserve(heap.size());
+  for (const Hit &hit : heap)
+    results.push_back({cursor->data[size_t(hit.version)], int(hit.verse)});
   return results;
 }
 
+std::vector<std::pair<int, int>>
+BibleManager::highlights(const SearchCursor &cursor, const VerseView &view) {
+  const BibleData &data = *view.data;
+  if (!cursor.substring.isEmpty())
+    return data.corpus().textRanges(quint32(view.index), cursor.substring);
+  return BibleQuery::textRanges(
+      data.store->verseUtf8(view.index),
+      cursor.query.matches(*data.index, quint32(view.index)));
+}
+
+std::vector<BibleVerse>
+BibleManager::toVerses(const std::vector<VerseView> &views,
+                       const SearchCursor *cursor) {
+  std::vector<BibleVerse> verses;
+  verses.reserve(views.size());
+  for (const VerseView &view : views) {
+    verses.push_back(view.toVerse());
+    if (cursor)
+      verses.back().matches = highlights(*cursor, view);
+  }
+  return verses;
+}
+
+BibleVerse BibleManager::VerseView::toVerse() const {
+  const VerseId id = this->id();
+  BibleVerse v{book(), verseIdChapter(id), verseIdVerse(id),
+               data->store->verseText(index), version()};
+  v.sharedId = sharedId();
+  return v;
+}
+
 QString BibleManager::getVerseText(const QString &book, int chapter, int verse,
                                    const QString &version) {
-  if (versions.count(version)) {
-    const auto &data = versions.at(version);
-    if (data.content.count(book) && data.content.at(book).count(chapter) &&
-        data.content.at(book).at(chapter).count(verse)) {
-      return data.content.at(book).at(chapter).at(verse);
+  if (auto loaded = acquire(version)) {
+    const BibleData &data = *loaded;
+    int bookNum = findBook(data, book);
+    if (bookNum > 0 && chapter >= 0 && chapter <= 0xff && verse >= 0 &&
+        verse <= 0xff) {
+      int index = data.store->find(makeVerseId(bookNum, chapter, verse));
+      if (index >= 0)
+        return data.store->verseText(index);
     }
   }
   return "";
 }
 
-QStringList BibleManager::getBooks(const QString &version) {
-  if (versions.count(version)) {
-    QStringList books;
-    for (const auto &[bookName, _] : versions.at(version).content) {
-      books.append(bookName);
+std::vector<BibleVerse>
+BibleManager::getVerses(const std::vector<VerseId> &sharedIds,
+                        const QString &version) {
+  std::vector<BibleVerse> verses;
+  verses.reserve(sharedIds.size());
+  const std::shared_ptr<const BibleData> data = acquire(version);
+  for (VerseId shared : sharedIds) {
+    const int i = data ? data->alignment.find(*data->store, shared) : -1;
+    if (i >= 0) {
+      verses.push_back(VerseView{data, i}.toVerse());
+      continue;
     }
-    // Ideally sort them canonically, but map sorts alphabetically by default
-    // key? Wait, std::map sorts by key. Bible books are not alphabetical. The
-    // XML parsing order might not be preserved if we use std::map<QString,
-    // ...>. We should probably rely on a fixed list of books for order or
-    // change structure. For now, return keys.
-    return books;
-  }
-  // Fallback: return keys from first available version if specific one not
-  // found?
-  if (!versions.empty()) {
-    QStringList books;
-    for (const auto &[bookName, _] : versions.begin()->second.content) {
+    BibleVerse v{QString(), verseIdChapter(shared), verseIdVerse(shared),
+                 QString(), version};
+    if (verseIdBook(shared) >= 1 &&
+        verseIdBook(shared) <= Bible::kCanonicalBookCount)
+      v.book = Bible::kCanonicalBooks[verseIdBook(shared) - 1].name;
+    v.sharedId = shared;
+    verses.push_back(std::move(v));
+  }
+  return verses;
+}
+
+int BibleManager::getBookId(const QString &book, const QString &version) {
+  const std::shared_ptr<const BibleData> data = acquire(version);
+  return data ? findBook(*data, book) : 0;
+}
+
+BibleManager::VerseSpan BibleManager::getChapter(int book, int chapter,
+                                                 const QString &version) {
+  VerseSpan span;
+  span.data = acquire(version);
+  if (span.data) {
+    std::tie(span.first, span.last) =
+        span.data->store->chapterRange(book, chapter);
+  }
+  return span;
+}
+
+BibleManager::VerseSpan
+BibleManager::getRange(const Bible::VerseRange &range,
+                       const QString &version) {
+  VerseSpan span;
+  span.data = acquire(version);
+  if (span.data && range.first <= range.last) {
+    const BibleStore &store = *span.data->store;
+    span.first = store.lowerBound(range.first);
+    span.last = store.lowerBound(range.last + 1);
+  }
+  return span;
+}
+
+QStringList BibleManager::getBooks(const QString &version) {
+  std::shared_ptr<const BibleData> data = acquire(version);
+  if (!data) {
+    // Fallback: return books from first available version if specific one
+    // not found
+    const std::shared_ptr<const VersionMap> loaded = snapshot();
+    if (!loaded->empty())
+      data = loaded->begin()->second;
+  }
+  if (!data)
+    return {};
+
+  // Book numbers are canonical, so this is canonical order
+  QStringList books;
+  for (const QString &bookName : data->bookKeys) {
+    if (!bookName.isEmpty())
       books.append(bookName);
-    }
-    return books;
   }
-  return {};
+  return books;
 }
 
 QString BibleManager::getLocalizedBookName(const QString &book,
                                            const QString &version) {
-  if (versions.count(version)) {
-    const auto &data = versions.at(version);
-    // data.displayNames maps Normalized -> Localized
-    // But we need to check if 'book' is normalized or not.
-    // Ideally, we normalize it first.
-    QString normalized = normalizeBookName(book);
-    if (data.displayNames.count(normalized)) {
-      return data.displayNames.at(normalized);
-    }
+  if (auto loaded = acquire(version)) {
+    const BibleData &data = *loaded;
+    // data.displayNames maps Normalized -> Localized. Names from search
+    // results are normalized already; others are normalized first.
+    auto name = data.displayNames.find(book);
+    if (name == data.displayNames.end())
+      name = data.displayNames.find(normalizeBookName(book));
+    if (name != data.displayNames.end())
+      return name->second;
   }
   return book; // Fallback to input
 }
 
 int BibleManager::getChapterCount(const QString &book, const QString &version) {
-  if (versions.count(version)) {
-    const auto &data = versions.at(version);
-    if (data.content.count(book)) {
-      return data.content.at(book).size();
-    }
+  if (auto loaded = acquire(version)) {
+    const BibleData &data = *loaded;
+    int bookNum = findBook(data, book);
+    if (bookNum > 0)
+      return data.store->chapterCount(bookNum);
   }
   return 0;
 }
 
 int BibleManager::getVerseCount(const QString &book, int chapter,
                                 const QString &version) {
-  if (versions.count(version)) {
-    const auto &data = versions.at(version);
-    if (data.content.count(book) && data.content.at(book).count(chapter)) {
-      return data.content.at(book).at(chapter).size();
+  if (auto loaded = acquire(version)) {
+    const BibleData &data = *loaded;
+    int bookNum = findBook(data, book);
+    if (bookNum > 0) {
+      auto [first, last] = data.store->chapterRange(bookNum, chapter);
+      return last - first;
     }
   }
   return 0;
 }
 
 QString BibleManager::getFirstVersion() const {
-  if (versions.empty())
+  const std::shared_ptr<const VersionMap> loaded = snapshot();
+  if (loaded->empty())
     return "";
-  return versions.begin()->first;
-}
-
-std::vector<BibleManager::BookInfo>
-BibleManager::getCanonicalBooks(const QString &version) const {
-  static const std::vector<BookInfo> canonicalList = {
-      // Old Testament
-      {"Genesis", Testament::Old, 50},
-      {"Exodus", Testament::Old, 40},
-      {"Leviticus", Testament::Old, 27},
-      {"Numbers", Testament::Old, 36},
-      {"Deuteronomy", Testament::Old, 34},
-      {"Joshua", Testament::Old, 24},
-      {"Judges", Testament::Old, 21},
-      {"Ruth", Testament::Old, 4},
-      {"1 Samuel", Testament::Old, 31},
-      {"2 Samuel", Testament::Old, 24},
-      {"1 Kings", Testament::Old, 22},
-      {"2 Kings", Testament::Old, 25},
-      {"1 Chronicles", Testament::Old, 29},
-      {"2 Chronicles", Testament::Old, 36},
-      {"Ezra", Testament::Old, 10},
-      {"Nehemiah", Testament::Old, 13},
-      {"Esther", Testament::Old, 10},
-      {"Job", Testament::Old, 42},
-      {"Psalms", Testament::Old, 150},
-      {"Proverbs", Testament::Old, 31},
-      {"Ecclesiastes", Testament::Old, 12},
-      {"Song of Solomon", Testament::Old, 8},
-      {"Isaiah", Testament::Old, 66},
-      {"Jeremiah", Testament::Old, 52},
-      {"Lamentations", Testament::Old, 5},
-      {"Ezekiel", Testament::Old, 48},
-      {"Daniel", Testament::Old, 12},
-      {"Hosea", Testament::Old, 14},
-      {"Joel", Testament::Old, 3},
-      {"Amos", Testament::Old, 9},
-      {"Obadiah", Testament::Old, 1},
-      {"Jonah", Testament::Old, 4},
-      {"Micah", Testament::Old, 7},
-      {"Nahum", Testament::Old, 3},
-      {"Habakkuk", Testament::Old, 3},
-      {"Zephaniah", Testament::Old, 3},
-      {"Haggai", Testament::Old, 2},
-      {"Zechariah", Testament::Old, 14},
-      {"Malachi", Testament::Old, 4},
-      // New Testament
-      {"Matthew", Testament::New, 28},
-      {"Mark", Testament::New, 16},
-      {"Luke", Testament::New, 24},
-      {"John", Testament::New, 21},
-      {"Acts", Testament::New, 28},
-      {"Romans", Testament::New, 16},
-      {"1 Corinthians", Testament::New, 16},
-      {"2 Corinthians", Testament::New, 13},
-      {"Galatians", Testament::New, 6},
-      {"Ephesians", Testament::New, 6},
-      {"Philippians", Testament::New, 4},
-      {"Colossians", Testament::New, 4},
-      {"1 Thessalonians", Testament::New, 5},
-      {"2 Thessalonians", Testament::New, 3},
-      {"1 Timothy", Testament::New, 6},
-      {"2 Timothy", Testament::New, 4},
-      {"Titus", Testament::New, 3},
-      {"Philemon", Testament::New, 1},
-      {"Hebrews", Testament::New, 13},
-      {"James", Testament::New, 5},
-      {"1 Peter", Testament::New, 5},
-      {"2 Peter", Testament::New, 3},
-      {"1 John", Testament::New, 5},
-      {"2 John", Testament::New, 1},
-      {"3 John", Testament::New, 1},
-      {"Jude", Testament::New, 1},
-      {"Revelation", Testament::New, 22}};
-
-  // If a version is provided, try to localize names
-  if (!version.isEmpty() && versions.count(version)) {
-    const auto &displayMap = versions.at(version).displayNames;
-    std::vector<BookInfo> localizedList = canonicalList;
-    for (auto &book : localizedList) {
-      if (displayMap.count(book.name)) {
-        book.name = displayMap.at(book.name);
-      }
+  return loaded->begin()->first;
+}
+
+BibleManager::BookList
+BibleManager::getCanonicalBooks(const QString &version) {
+  static const std::vector<BookInfo> canonicalList = [] {
+    std::vector<BookInfo> list;
+    int number = 0;
+    for (const auto &book : Bible::kCanonicalBooks) {
+      list.push_back({book.name, book.testament, book.chapters, ++number});
     }
-    return localizedList;
-  }
+    return list;
+  }();
 
-  return canonicalList;
+  std::shared_ptr<const BibleData> data =
+      version.isEmpty() ? nullptr : acquire(version);
+  if (data) {
+    const std::vector<BookInfo> &books = data->canonicalBooks;
+    return {data, books.data(), books.data() + books.size()};
+  }
+  return {nullptr, canonicalList.data(),
+          canonicalList.data() + canonicalList.size()};
 }
 
 QStringList BibleManager::getVersions() const {
   QStringList names;
-  for (const auto &[name, _] : versions) {
+  for (const auto &[name, _] : *snapshot()) {
     names.append(name);
   }
   return names;
 }
+
+QStringList BibleManager::getKnownVersions() const {
+  QStringList names;
+  for (const auto &[name, _] : knownVersions)
+    names.append(name);
+  return names;
+}
+
+bool BibleManager::isVersionLoaded(const QString &version) const {
+  return snapshot()->count(version) > 0;
+}
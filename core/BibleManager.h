@@ -1,15 +1,37 @@
 #pragma once
+#include "BibleBooks.h"
+#include "BibleCorpus.h"
+#include "BibleIndex.h"
+#include "BibleReference.h"
+#include "BibleSpelling.h"
+#include "BibleStore.h"
+#include "BibleVersification.h"
+#include "LruCache.h"
 #include <QObject>
 #include <QString>
+#include <QUtf8StringView>
+#include <atomic>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <vector>
 
+class QFileSystemWatcher;
+class QThreadPool;
+class QTimer;
+
 struct BibleVerse {
   QString book;
   int chapter;
   int verse;
   QString text;
   QString version;
+  // Keyword hits in text as [start, length) ranges, for highlighting
+  std::vector<std::pair<int, int>> matches;
+  // Same in every version, whatever its numbering (see Bible::VerseAlignment)
+  VerseId sharedId = 0;
 };
 
 struct BibleBook {
@@ -23,25 +45,266 @@ public:
   static BibleManager &instance();
 
   // Normalize book name to standard English name (e.g. "Mwanzo" -> "Genesis")
+  // Unknown names and ambiguous prefixes ("Jo") are returned unchanged; see
+  // Bible::lookupBookName for details
   static QString normalizeBookName(const QString &input);
 
-  // Loads Bible data from XML files in assets/bible
-  void loadBibles();
+  // Finds the XML files in assets/bible and returns immediately, having
+  // read none of them: a version is loaded in the background the first time
+  // it is asked for, by a call naming it or by requestVersion(), and is
+  // missing until versionLoaded() announces it. The versions in preload are
+  // requested right away, or the first one found if none of them is.
+  //
+  // The directory is then watched: a version whose file changes is loaded
+  // again in the background if it is loaded, and replaces the old data only
+  // once it is complete, so searches are never held up or see it half built.
+  // Files added or removed change the known versions (see versionsChanged).
+  void loadBibles(const QStringList &preload = {});
+
+  // Loads a known version on a worker pool (one task per version) unless it
+  // is loaded or loading already. It is announced with versionLoaded() as
+  // soon as it is usable; bibleLoaded() fires once every requested version
+  // has finished.
+  void requestVersion(const QString &version);
+
+  // Loaded versions beyond the budget are unloaded again, least recently
+  // used first; the one used last always stays. Searches and VerseViews
+  // holding an unloaded version keep it alive until they finish.
+  void setMemoryBudget(qint64 bytes);
+  qint64 memoryBudget() const { return budget; }
+  static constexpr qint64 kDefaultMemoryBudget = qint64(256) << 20;
+
+  using Testament = Bible::Testament;
+  struct BookInfo {
+    QString name; // Localized, if known
+    Testament testament;
+    int chapters;
+    int number = 0; // Book field of VerseId
+    int verses = 0; // In the whole book; 0 without a version
+  };
+
+  // One loaded version. Immutable once loaded; searches and VerseViews share
+  // it, so it outlives a reload for as long as they hold it.
+  struct BibleData {
+    QString name; // Version name (e.g. "NKJV")
+    // Compiled verse table and text, memory-mapped from the Bible cache
+    std::unique_ptr<BibleStore> store;
+    // Word index over store, for keyword search
+    std::unique_ptr<BibleIndex> index;
+    // Trigrams of the words of index, for misspelled keywords
+    std::unique_ptr<BibleSpelling> spelling;
+    // Shared verse ids of the verses in store
+    Bible::VerseAlignment alignment;
+    // Normalized Name -> Book number in store
+    std::map<QString, int> books;
+    // Book number - 1 -> Normalized Name (empty for books not present)
+    std::vector<QString> bookKeys;
+    // Normalized Name -> Localized Name (e.g., "Genesis" -> "Mwanzo")
+    std::map<QString, QString> displayNames;
+    // The canonical books in store (see getCanonicalBooks)
+    std::vector<BookInfo> canonicalBooks;
+
+    // Lower-cased text of store, for substring search. Built on first use,
+    // on whichever thread needs it: most sessions never do.
+    const BibleCorpus &corpus() const;
+    // The corpus, or nullptr while it has not been built
+    const BibleCorpus *builtCorpus() const;
+
+  private:
+    mutable std::mutex corpusMutex;
+    mutable std::unique_ptr<BibleCorpus> lazyCorpus;
+  };
+
+  // Memory held by one loaded version, in bytes
+  struct MemoryUsage {
+    qint64 image = 0;    // Compiled verse table and UTF-8 text
+    bool mapped = false; // image is mapped from the cache file (file-backed)
+    qint64 tables = 0;   // Lookup tables of the store
+    qint64 index = 0;    // Keyword index and its spelling index
+    qint64 corpus = 0;   // Substring corpus; 0 until it is first needed
+    // Memory the process allocated for the version
+    qint64 heap() const {
+      return (mapped ? 0 : image) + tables + index + corpus;
+    }
+    // Same, with the mapped image: what counts against the memory budget
+    qint64 total() const { return image + tables + index + corpus; }
+  };
+  MemoryUsage getMemoryUsage(const QString &version) const;
+
+  // A verse of a loaded version that points into the version's store instead
+  // of copying its text, so copying one allocates nothing
+  struct VerseView {
+    std::shared_ptr<const BibleData> data;
+    int index; // Into data->store
+
+    VerseId id() const { return data->store->verseId(index); }
+    VerseId sharedId() const {
+      return data->alignment.sharedId(*data->store, index);
+    }
+    // Normalized book name
+    const QString &book() const {
+      return data->bookKeys[size_t(verseIdBook(id()) - 1)];
+    }
+    int chapter() const { return verseIdChapter(id()); }
+    int verse() const { return verseIdVerse(id()); }
+    const QString &version() const { return data->name; }
+    QUtf8StringView text() const {
+      const QByteArrayView utf8 = data->store->verseUtf8(index);
+      return QUtf8StringView(utf8.data(), utf8.size());
+    }
+    // A BibleVerse with the text decoded, without highlights
+    BibleVerse toVerse() const;
+  };
+
+  // A run of consecutive verses of a loaded version, in canonical order:
+  // data->store indices [first, last)
+  struct VerseSpan {
+    std::shared_ptr<const BibleData> data;
+    int first = 0;
+    int last = 0;
+
+    int size() const { return last - first; }
+    bool empty() const { return first == last; }
+    VerseView operator[](int i) const { return {data, first + i}; }
+  };
+
+  // Version Name (e.g., "NKJV") -> Data of the loaded versions
+  using VersionMap = std::map<QString, std::shared_ptr<const BibleData>>;
+
+  // The versions loaded at the time of the call. The map never changes once
+  // returned; loading or unloading a version publishes a new one. Safe on
+  // any thread, and takes no lock.
+  std::shared_ptr<const VersionMap> snapshot() const;
+
+  // Ranked keyword hits of one search, kept for paging (see fetchMore)
+  struct SearchCursor;
+
+  // Lookups served by the cache of recent results in front of search(),
+  // searchViews() and searchAsync() without a session. Results are cached
+  // per version and query (with runs of whitespace collapsed), and dropped
+  // once a version they came from is reloaded or unloaded.
+  struct CacheStats {
+    quint64 hits = 0;
+    quint64 misses = 0;
+    size_t entries = 0;
+  };
+  CacheStats getSearchCacheStats() const;
 
   // Search for verses by keyword or reference
-  // Support queries like "Jesus wept" or "John 3:16"
-  // If version is empty, searches all versions
-  std::vector<BibleVerse> search(const QString &query,
-                                 const QString &version = "");
+  // Support queries like "Jesus wept" or "John 3:16"; references may be lists
+  // ("John 3:16-18; Ps 23", see Bible::parseReferences) and keyword queries
+  // may use AND/OR/NOT, "phrases" and NEAR/n (see BibleQuery). A query no
+  // verse has the words of is looked up as a substring ("ness of"), and
+  // failing that, with its misspelled words corrected ("rightousness").
+  // If version is empty, searches all loaded versions. A version named but
+  // not loaded is requested (see getVerseText), and all loaded versions are
+  // searched until it loads.
+  // Keyword hits come best first (BM25), one page at a time; pass cursor to
+  // keep the ranked hits for fetchMore()
+  std::vector<BibleVerse>
+  search(const QString &query, const QString &version = "",
+         std::shared_ptr<SearchCursor> *cursor = nullptr);
+  // Same, as views into the loaded versions: nothing is copied or decoded,
+  // and keyword hits are not highlighted (see highlights())
+  std::vector<VerseView>
+  searchViews(const QString &query, const QString &version = "",
+              std::shared_ptr<SearchCursor> *cursor = nullptr);
+
+  // Next page of a keyword search without evaluating the query again. Empty
+  // once every hit has been returned. Does not touch the loaded versions, so
+  // it is safe on any thread.
+  static std::vector<BibleVerse>
+  fetchMore(const std::shared_ptr<SearchCursor> &cursor,
+            int count = kSearchPageSize);
+  static std::vector<VerseView>
+  fetchViews(const std::shared_ptr<SearchCursor> &cursor,
+             int count = kSearchPageSize);
+  // Keyword hits in a verse found by the search of cursor, as [start,
+  // length) ranges of its text (see BibleVerse::matches)
+  static std::vector<std::pair<int, int>>
+  highlights(const SearchCursor &cursor, const VerseView &view);
+
+  static constexpr int kSearchPageSize = 50;
+
+  // Cancels an asynchronous search (see searchAsync)
+  class SearchToken {
+  public:
+    void cancel() { canceled.store(true, std::memory_order_relaxed); }
+    bool isCanceled() const { return canceled.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<bool> canceled{false};
+  };
+
+  // Part of the results of an asynchronous search
+  struct SearchBatch {
+    std::vector<BibleVerse> verses;
+    bool first = false; // First batch of its search: replaces older results
+    bool last = false;  // No more batches follow
+    // Last batch only: keyword hits not delivered yet, for fetchMore()
+    std::shared_ptr<SearchCursor> cursor;
+  };
+  using SearchHandler = std::function<void(const SearchBatch &)>;
+
+  // State of an as-you-type search, carried from one keystroke to the next
+  struct SearchSession;
+
+  // Runs search() on a background thread and hands the results to handler
+  // on the GUI thread, kSearchBatchSize verses at a time. A search always
+  // delivers at least one batch (first and last, possibly empty) unless it
+  // is canceled, after which none of its batches are delivered.
+  //
+  // Starting a search for a receiver cancels the one it started before, so
+  // results of a superseded query never arrive; nothing arrives after the
+  // receiver is destroyed either.
+  //
+  // With a session (created if null), the search is limited to version and
+  // reuses the previous search of the session: a keyword query that extends
+  // the previous one is narrowed from its matches instead of being evaluated
+  // again.
+  std::shared_ptr<SearchToken>
+  searchAsync(const QString &query, const QString &version, QObject *receiver,
+              SearchHandler handler,
+              std::shared_ptr<SearchSession> *session = nullptr);
+
+  static constexpr int kSearchBatchSize = 10;
 
   // Get list of all loaded version names
   QStringList getVersions() const;
 
+  // Get list of versions found on disk, loaded or not. GUI thread only, like
+  // loadBibles(), requestVersion() and setMemoryBudget().
+  QStringList getKnownVersions() const;
+  bool isVersionLoaded(const QString &version) const;
+
+  // The calls below never wait for a load: a version known but not loaded is
+  // requested, and missing until versionLoaded() announces it. On the GUI
+  // thread they count as a use of the version for unloading (see
+  // setMemoryBudget); on any other thread they read snapshot().
+
   // Get a specific verse
   QString getVerseText(const QString &book, int chapter, int verse,
                        const QString &version = "NKJV");
 
-  // Get list of books available in a version
+  // The verses with the given shared ids (BibleVerse::sharedId) in a
+  // version, in the same order: one table lookup each, without searching or
+  // resolving names, so a whole chapter switches version at once. A verse
+  // the version lacks comes back with empty text.
+  std::vector<BibleVerse> getVerses(const std::vector<VerseId> &sharedIds,
+                                    const QString &version);
+
+  // Book number of a normalized or localized book name in a version (the
+  // canonical number for canonical books), or 0 if the version lacks it
+  int getBookId(const QString &book, const QString &version);
+
+  // The verses of a chapter, or of an inclusive range of verse ids (see
+  // Bible::VerseRange), straight from the version's verse table: O(1) for a
+  // chapter, O(log n) for a range, without parsing or searching. Empty if
+  // the version has none of them.
+  VerseSpan getChapter(int book, int chapter, const QString &version);
+  VerseSpan getRange(const Bible::VerseRange &range, const QString &version);
+
+  // Get list of books available in a version, in canonical order
   QStringList getBooks(const QString &version = "NKJV");
 
   // Get localized book name (e.g., "Genesis" -> "Mwanzo" for SWAB)
@@ -55,34 +318,173 @@ public:
   int getVerseCount(const QString &book, int chapter,
                     const QString &version = "NKJV");
 
-  // Get first available version name
+  // Get first loaded version name
   QString getFirstVersion() const;
 
-  enum class Testament { Old, New };
-  struct BookInfo {
-    QString name;
-    Testament testament;
-    int chapters;
+  // Books of a version, in canonical order; keeps the version alive like
+  // VerseSpan
+  struct BookList {
+    std::shared_ptr<const BibleData> data;
+    const BookInfo *first = nullptr;
+    const BookInfo *last = nullptr;
+
+    const BookInfo *begin() const { return first; }
+    const BookInfo *end() const { return last; }
+    int size() const { return int(last - first); }
+    bool empty() const { return first == last; }
   };
 
   // Get books in canonical order with metadata
-  // If version is provided, localized names are returned
-  std::vector<BookInfo> getCanonicalBooks(const QString &version = "") const;
+  // If version is provided, the canonical books that version has, with
+  // their localized names and counts from its text, worked out once when it
+  // loaded. Otherwise all 66 with their English names and usual counts.
+  BookList getCanonicalBooks(const QString &version = "");
 
 signals:
+  // A version was loaded, or loaded again after its file changed
+  void versionLoaded(const QString &version);
+  // A version was unloaded to stay within the memory budget
+  void versionUnloaded(const QString &version);
+  // Versions were added to or removed from the Bible directory
+  void versionsChanged();
+  void loadProgress(int finished, int total);
   void bibleLoaded();
 
 private:
   explicit BibleManager(QObject *parent = nullptr);
 
-  struct BibleData {
-    // Map: Book Name -> Chapter Num -> Verse Num -> Text
-    std::map<QString, std::map<int, std::map<int, QString>>> content;
-    // Normalized Name -> Localized Name (e.g., "Genesis" -> "Mwanzo")
-    std::map<QString, QString> displayNames;
+  // The loaded versions, changed on the GUI thread only; see published
+  VersionMap versions;
+  // An immutable copy of versions, replaced by publish() after every change
+  // (read-copy-update). Readers load it atomically and search it without
+  // locks while the GUI thread builds the next one; the copy they hold and
+  // the data in it stay valid for as long as they hold it.
+  std::shared_ptr<const VersionMap> published;
+  void publish();
+  // Version Name -> When it was last used, for unloading (see acquire)
+  std::map<QString, quint64> lastUse;
+  quint64 useClock = 0;
+  qint64 budget = kDefaultMemoryBudget;
+
+  // A version being loaded on a loader thread
+  struct PendingLoad {
+    std::shared_ptr<BibleData> data; // Set by the loader task
+  };
+
+  QThreadPool *loaderPool;
+  // Runs searches one at a time; a canceled one gives up early
+  QThreadPool *searchPool;
+
+  // Recent results (see getSearchCacheStats). An entry is only used while
+  // the versions it came from are still the ones loaded.
+  using SearchKey = std::pair<QString, QString>; // Version, query
+  struct CachedSearch {
+    std::vector<std::shared_ptr<const BibleData>> data; // Versions searched
+    std::vector<VerseView> views;
+    // The ranked hits as they were after the first page; each caller asking
+    // for a cursor gets a copy
+    std::shared_ptr<const SearchCursor> cursor;
   };
+  // Guards the cache: searches fill it from the search thread
+  mutable std::mutex cacheMutex;
+  LruCache<SearchKey, CachedSearch> searchCache{kSearchCacheSize};
+  static constexpr size_t kSearchCacheSize = 64;
+  // Receiver -> its search in flight (see searchAsync)
+  std::map<const QObject *, std::shared_ptr<SearchToken>> activeSearches;
+  // Version Name -> XML file of every version found on disk
+  std::map<QString, QString> knownVersions;
+  std::map<QString, std::shared_ptr<PendingLoad>> pendingLoads;
+  int loadsFinished = 0;
+  int loadsTotal = 0;
+
+  // Watches the Bible directory and its files (see loadBibles)
+  QString bibleDir;
+  QFileSystemWatcher *watcher = nullptr;
+  // Editors and copies write a file in several steps: changes are handled
+  // once none has been reported for kRescanDelayMs
+  QTimer *rescanTimer;
+  std::set<QString> changedFiles;
+  static constexpr int kRescanDelayMs = 500;
+
+  // Version Name -> XML file of the versions in bibleDir
+  std::map<QString, QString> scanBibleDir() const;
+  // Brings knownVersions in line with bibleDir and reloads the loaded
+  // versions whose files changed
+  void rescanBibles();
+
+  // The data of a loaded version, or nullptr after requesting the load of a
+  // known one. Marks it used. Off the GUI thread, only looks the version up
+  // in snapshot().
+  std::shared_ptr<const BibleData> acquire(const QString &version);
+
+  // Loads a version on a loader task; see finishVersion
+  void startLoad(const QString &versionName, const QString &filePath);
+  // Runs on a loader thread; returns nullptr if the version failed to load
+  static std::shared_ptr<BibleData> buildVersion(const QString &filePath,
+                                                 const QString &versionName);
+  // Runs on the GUI thread once a loader task finishes
+  void finishVersion(const QString &versionName,
+                     const std::shared_ptr<PendingLoad> &load);
+  // Publishes loaded data, replacing that of an earlier load; a failed
+  // reload keeps the earlier data
+  void addVersion(const QString &versionName,
+                  std::shared_ptr<const BibleData> data);
+  // Unloads least recently used versions until the rest fit the budget
+  void enforceBudget();
+
+  static MemoryUsage memoryUsage(const BibleData &data);
+
+  // Book number in data.store for a normalized or localized name, 0 if absent
+  static int findBook(const BibleData &data, const QString &book);
+
+  // Appends the verses of the ranges (see Bible::parseReferences) found in
+  // one version, up to kMaxReferenceVerses in all
+  static void appendReferences(const std::shared_ptr<const BibleData> &data,
+                               const std::vector<Bible::VerseRange> &ranges,
+                               std::vector<VerseView> &results);
+  static constexpr size_t kMaxReferenceVerses = 50;
+
+  // Copies views into BibleVerses, highlighting the hits of cursor if given
+  static std::vector<BibleVerse> toVerses(const std::vector<VerseView> &views,
+                                          const SearchCursor *cursor);
+
+  // Looks the query up as a raw substring in the versions of a keyword
+  // search that found nothing, keeping the first kMaxSubstringVerses hits.
+  // Runs in parallel over shards of kSubstringShardVerses. Returns false
+  // once token is canceled.
+  static bool findSubstring(SearchCursor &cursor, const QString &query,
+                            const SearchToken *token);
+  static constexpr size_t kMaxSubstringVerses = 1000;
+  static constexpr int kSubstringShardVerses = 4096;
 
-  std::map<QString, BibleData> versions; // Version Name (e.g., "NKJV") -> Data
+  // Runs the keyword query of a search that found nothing again, with each
+  // word no verse has also matching its closest spellings (see
+  // BibleSpelling), at most kMaxSpellings of them. Returns false once token
+  // is canceled.
+  static bool findRespelled(SearchCursor &cursor, const SearchToken *token);
+  static constexpr size_t kMaxSpellings = 3;
 
-  void parseXML(const QString &filePath, const QString &versionName);
+  // search() over a snapshot of the versions, safe on any thread. Versions
+  // are searched in parallel on the global thread pool. Returns early, with
+  // partial or no results, once token is canceled.
+  static std::vector<VerseView>
+  searchVersions(const VersionMap &snapshot, const QString &query,
+                 const QString &version, std::shared_ptr<SearchCursor> *cursor,
+                 const SearchToken *token);
+  // Same, through searchCache; safe on any thread. Canceled searches are
+  // not cached.
+  std::vector<VerseView> searchCached(const VersionMap &snapshot,
+                                      const QString &query,
+                                      const QString &version,
+                                      std::shared_ptr<SearchCursor> *cursor,
+                                      const SearchToken *token);
+  // Drops the cached results that depend on a version, or on data of any
+  // version no longer loaded. GUI thread only.
+  void dropCached(const QString &version);
+  // Same, limited to version and reusing session (see searchAsync)
+  static std::vector<VerseView>
+  searchIncremental(SearchSession &session, const VersionMap &snapshot,
+                    const QString &query, const QString &version,
+                    std::shared_ptr<SearchCursor> *cursor,
+                    const SearchToken *token);
 };
@@ -0,0 +1,758 @@
+#include "BibleQuery.h"
+#include "BibleStore.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+using Verses = std::vector<quint32>;
+
+// Prefix terms covering more words than this are matched inside a verse by
+// re-tokenizing it rather than probing every term's posting list
+constexpr int kMaxProbedTerms = 8;
+
+// Rough cost of finding a word in one verse, in postings merged: per term
+// probed, and for re-tokenizing the verse
+constexpr qint64 kProbeCostInPostings = 8;
+constexpr qint64 kTokenizeCostInPostings = 400;
+
+constexpr int kDefaultNearDistance = 10;
+
+// BM25 parameters (the usual defaults)
+constexpr double kBm25K1 = 1.2;
+constexpr double kBm25B = 0.75;
+
+// First element >= value in [first, last). Probes 1, 2, 4, ... ahead before
+// bisecting, so walking a long list with ascending values skips most of it.
+const quint32 *gallop(const quint32 *first, const quint32 *last,
+                      quint32 value) {
+  qsizetype step = 1;
+  const quint32 *lo = first;
+  while (lo + step < last && lo[step] < value) {
+    lo += step;
+    step *= 2;
+  }
+  return std::lower_bound(lo, std::min(lo + step + 1, last), value);
+}
+
+Verses intersect(const Verses &a, const Verses &b) {
+  const Verses &small = a.size() <= b.size() ? a : b;
+  const Verses &large = a.size() <= b.size() ? b : a;
+  Verses out;
+  const quint32 *cursor = large.data();
+  const quint32 *end = large.data() + large.size();
+  for (quint32 v : small) {
+    cursor = gallop(cursor, end, v);
+    if (cursor == end)
+      break;
+    if (*cursor == v)
+      out.push_back(v);
+  }
+  return out;
+}
+
+Verses subtract(const Verses &a, const Verses &b) {
+  Verses out;
+  const quint32 *cursor = b.data();
+  const quint32 *end = b.data() + b.size();
+  for (quint32 v : a) {
+    cursor = gallop(cursor, end, v);
+    if (cursor == end || *cursor != v)
+      out.push_back(v);
+  }
+  return out;
+}
+
+Verses unite(const Verses &a, const Verses &b) {
+  Verses out;
+  out.reserve(a.size() + b.size());
+  std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+                 std::back_inserter(out));
+  return out;
+}
+
+Verses complement(const Verses &a, int verseCount) {
+  Verses out;
+  out.reserve(size_t(verseCount) - std::min(a.size(), size_t(verseCount)));
+  auto it = a.begin();
+  for (quint32 v = 0; v < quint32(verseCount); ++v) {
+    if (it != a.end() && *it == v)
+      ++it;
+    else
+      out.push_back(v);
+  }
+  return out;
+}
+
+void sortSpans(std::vector<BibleQuery::Span> &spans) {
+  std::sort(spans.begin(), spans.end(),
+            [](const BibleQuery::Span &a, const BibleQuery::Span &b) {
+              return a.start != b.start ? a.start < b.start
+                                        : a.length < b.length;
+            });
+  spans.erase(std::unique(spans.begin(), spans.end(),
+                          [](const BibleQuery::Span &a,
+                             const BibleQuery::Span &b) {
+                            return a.start == b.start && a.length == b.length;
+                          }),
+              spans.end());
+}
+
+bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+} // namespace
+
+// Recursive-descent parser over the raw UTF-8 of the query:
+//   or      := and (OR and)*
+//   and     := unary ([AND] unary)*
+//   unary   := NOT unary | near
+//   near    := primary (NEAR[/n] primary)*
+//   primary := '(' or ')' | '"' words '"' | word
+class BibleQuery::Parser {
+public:
+  Parser(BibleQuery &query, QByteArrayView text) : q(query), text(text) {}
+
+  int parseQuery() {
+    int root = -1;
+    while (peek().kind != Lexeme::End) {
+      root = combine(Node::And, root, parseOr());
+      if (peek().kind == Lexeme::Close)
+        next(); // Unbalanced ')'
+    }
+    return root;
+  }
+
+private:
+  struct Lexeme {
+    enum Kind { Word, Phrase, Open, Close, And, Or, Not, Near, End } kind;
+    QByteArrayView text; // Word / Phrase contents
+    bool open = false;   // Ends the query without a space or closing quote
+    int distance = 0;    // Near
+  };
+
+  BibleQuery &q;
+  QByteArrayView text;
+  qsizetype pos = 0;
+  bool hasLookahead = false;
+  Lexeme lookahead;
+
+  const Lexeme &peek() {
+    if (!hasLookahead) {
+      lookahead = lex();
+      hasLookahead = true;
+    }
+    return lookahead;
+  }
+  Lexeme next() {
+    peek();
+    hasLookahead = false;
+    return lookahead;
+  }
+
+  Lexeme lex() {
+    while (pos < text.size() && isSpace(text[pos]))
+      ++pos;
+    if (pos >= text.size())
+      return {Lexeme::End, {}};
+
+    const char c = text[pos];
+    if (c == '(') {
+      ++pos;
+      return {Lexeme::Open, {}};
+    }
+    if (c == ')') {
+      ++pos;
+      return {Lexeme::Close, {}};
+    }
+    if (c == '"') {
+      const qsizetype start = ++pos;
+      while (pos < text.size() && text[pos] != '"')
+        ++pos;
+      Lexeme phrase{Lexeme::Phrase, text.sliced(start, pos - start)};
+      phrase.open = pos >= text.size();
+      if (!phrase.open)
+        ++pos; // Closing quote
+      return phrase;
+    }
+    if (c == '-' && pos + 1 < text.size() && !isSpace(text[pos + 1])) {
+      ++pos;
+      return {Lexeme::Not, {}};
+    }
+
+    const qsizetype start = pos;
+    while (pos < text.size() && !isSpace(text[pos]) && text[pos] != '(' &&
+           text[pos] != ')' && text[pos] != '"')
+      ++pos;
+    const QByteArrayView chunk = text.sliced(start, pos - start);
+    if (chunk == QByteArrayView("AND"))
+      return {Lexeme::And, {}};
+    if (chunk == QByteArrayView("OR"))
+      return {Lexeme::Or, {}};
+    if (chunk == QByteArrayView("NOT"))
+      return {Lexeme::Not, {}};
+    if (chunk.startsWith(QByteArrayView("NEAR"))) {
+      Lexeme near{Lexeme::Near, {}};
+      near.distance = kDefaultNearDistance;
+      if (chunk.size() == 4)
+        return near;
+      if (chunk.size() > 5 && chunk[4] == '/') {
+        int n = 0;
+        qsizetype i = 5;
+        for (; i < chunk.size() && chunk[i] >= '0' && chunk[i] <= '9'; ++i)
+          n = std::min(n * 10 + (chunk[i] - '0'), 0xffff);
+        if (i == chunk.size()) {
+          near.distance = n;
+          return near;
+        }
+      }
+    }
+    Lexeme word{Lexeme::Word, chunk};
+    word.open = pos >= text.size();
+    return word;
+  }
+
+  int add(Node node) {
+    q.m_nodes.push_back(std::move(node));
+    return int(q.m_nodes.size()) - 1;
+  }
+
+  // Joins two operands, flattening into an existing node of the same kind
+  int combine(Node::Kind kind, int a, int b) {
+    if (a < 0)
+      return b;
+    if (b < 0)
+      return a;
+    if (q.m_nodes[a].kind == kind) {
+      q.m_nodes[a].children.push_back(b);
+      return a;
+    }
+    Node node{kind};
+    node.children = {a, b};
+    return add(std::move(node));
+  }
+
+  int parseOr() {
+    int node = parseAnd();
+    while (peek().kind == Lexeme::Or) {
+      next();
+      node = combine(Node::Or, node, parseAnd());
+    }
+    return node;
+  }
+
+  int parseAnd() {
+    int node = -1;
+    for (;;) {
+      const Lexeme::Kind kind = peek().kind;
+      if (kind == Lexeme::Or || kind == Lexeme::Close || kind == Lexeme::End)
+        return node;
+      if (kind == Lexeme::And) {
+        next();
+        continue;
+      }
+      node = combine(Node::And, node, parseUnary());
+    }
+  }
+
+  int parseUnary() {
+    if (peek().kind != Lexeme::Not)
+      return parseNear();
+    next();
+    int child = parseUnary();
+    if (child < 0)
+      return -1;
+    Node node{Node::Not};
+    node.children = {child};
+    return add(std::move(node));
+  }
+
+  int parseNear() {
+    int node = parsePrimary();
+    while (peek().kind == Lexeme::Near) {
+      const int distance = next().distance;
+      int other = parsePrimary();
+      if (node < 0 || other < 0) {
+        node = node < 0 ? other : node;
+        continue;
+      }
+      Node near{Node::Near};
+      near.distance = distance;
+      near.children = {node, other};
+      node = add(std::move(near));
+    }
+    return node;
+  }
+
+  int parsePrimary() {
+    const Lexeme lexeme = next();
+    switch (lexeme.kind) {
+    case Lexeme::Open: {
+      int node = parseOr();
+      if (peek().kind == Lexeme::Close)
+        next();
+      return node;
+    }
+    case Lexeme::Word:
+    case Lexeme::Phrase:
+      return parseWords(lexeme);
+    default:
+      return -1; // Stray operator
+    }
+  }
+
+  // A word that tokenizes to several tokens ("lord's", "well-pleased") is a
+  // phrase of them
+  int parseWords(const Lexeme &lexeme) {
+    Node phrase{Node::Phrase};
+    const QByteArrayView words = lexeme.text;
+    BibleIndex::tokenize(words, [&](QByteArrayView token, int, qsizetype offset,
+                                    qsizetype length) {
+      Node term{Node::Term};
+      term.word.assign(token.data(), size_t(token.size()));
+      term.prefix = offset + length < words.size() &&
+                    words[offset + length] == '*';
+      // A still-open last word matches as a prefix
+      if (lexeme.open && offset + length == words.size())
+        term.prefix = true;
+      phrase.children.push_back(add(std::move(term)));
+    });
+    if (phrase.children.size() <= 1)
+      return phrase.children.empty() ? -1 : phrase.children.front();
+    return add(std::move(phrase));
+  }
+};
+
+BibleQuery BibleQuery::parse(const QString &text) {
+  BibleQuery query;
+  const QByteArray utf8 = text.toUtf8();
+  Parser parser(query, utf8);
+  query.m_root = parser.parseQuery();
+  return query;
+}
+
+std::vector<quint32> BibleQuery::evaluate(const BibleIndex &index) const {
+  if (m_root < 0)
+    return {};
+  return evaluate(index, m_root);
+}
+
+std::vector<BibleQuery::Span> BibleQuery::matches(const BibleIndex &index,
+                                                  quint32 verse) const {
+  if (m_root < 0)
+    return {};
+  std::vector<Span> result = spans(index, m_root, verse);
+  sortSpans(result);
+  return result;
+}
+
+bool BibleQuery::isConjunction() const {
+  if (m_root < 0)
+    return false;
+  const Node &root = m_nodes[m_root];
+  if (root.kind == Node::Term)
+    return true;
+  if (root.kind != Node::And)
+    return false;
+  return std::all_of(root.children.begin(), root.children.end(),
+                     [this](int child) {
+                       return m_nodes[child].kind == Node::Term;
+                     });
+}
+
+int BibleQuery::wordCount() const {
+  if (!isConjunction())
+    return 0;
+  const Node &root = m_nodes[m_root];
+  return root.kind == Node::Term ? 1 : int(root.children.size());
+}
+
+int BibleQuery::wordNode(int word) const {
+  const Node &root = m_nodes[m_root];
+  return root.kind == Node::Term ? m_root : root.children[size_t(word)];
+}
+
+bool BibleQuery::sameWord(int word, const BibleQuery &other) const {
+  const Node &a = m_nodes[wordNode(word)];
+  const Node &b = other.m_nodes[other.wordNode(word)];
+  return a.word == b.word && a.prefix == b.prefix;
+}
+
+bool BibleQuery::narrowsWord(int word, const BibleQuery &previous) const {
+  const Node &a = m_nodes[wordNode(word)];
+  const Node &b = previous.m_nodes[previous.wordNode(word)];
+  if (b.prefix)
+    return a.word.compare(0, b.word.size(), b.word) == 0;
+  return a.word == b.word && !a.prefix;
+}
+
+std::string BibleQuery::wordKey(int word) const {
+  const Node &node = m_nodes[wordNode(word)];
+  return node.prefix ? node.word + '*' : node.word;
+}
+
+qint64 BibleQuery::wordFrequency(const BibleIndex &index, int word) const {
+  return frequency(index, wordNode(word));
+}
+
+std::vector<std::string>
+BibleQuery::unknownWords(const BibleIndex &index) const {
+  std::vector<std::string> words;
+  for (const Node &node : m_nodes) {
+    if (node.kind != Node::Term)
+      continue;
+    auto [first, last] = termRange(index, node);
+    if (first >= last &&
+        std::find(words.begin(), words.end(), node.word) == words.end())
+      words.push_back(node.word);
+  }
+  return words;
+}
+
+BibleQuery BibleQuery::withAlternatives(
+    const std::map<std::string, std::vector<std::string>> &alternatives)
+    const {
+  BibleQuery query = *this;
+  const size_t count = query.m_nodes.size();
+  for (size_t n = 0; n < count; ++n) {
+    if (query.m_nodes[n].kind != Node::Term)
+      continue;
+    auto it = alternatives.find(query.m_nodes[n].word);
+    if (it == alternatives.end() || it->second.empty())
+      continue;
+    // The word's node becomes an Or of the word and its alternatives, so
+    // phrases and operators above it are unchanged
+    Node choice{Node::Or};
+    choice.children.push_back(int(query.m_nodes.size()));
+    query.m_nodes.push_back(query.m_nodes[n]);
+    for (const std::string &word : it->second) {
+      Node term{Node::Term};
+      term.word = word;
+      choice.children.push_back(int(query.m_nodes.size()));
+      query.m_nodes.push_back(std::move(term));
+    }
+    query.m_nodes[n] = std::move(choice);
+  }
+  return query;
+}
+
+std::vector<quint32>
+BibleQuery::filterWord(const BibleIndex &index, int word,
+                       const std::vector<quint32> &candidates) const {
+  const int node = wordNode(word);
+  auto [first, last] = termRange(index, m_nodes[node]);
+  if (first >= last)
+    return {};
+
+  // Intersect with the word's posting lists when they are short next to the
+  // candidates, otherwise look the word up in each candidate
+  const qint64 probeCost = last - first > kMaxProbedTerms
+                               ? kTokenizeCostInPostings
+                               : kProbeCostInPostings * (last - first);
+  if (index.postingCount(first, last) <= qint64(candidates.size()) * probeCost)
+    return intersect(candidates, evaluate(index, node));
+
+  Verses out;
+  for (quint32 v : candidates) {
+    if (!spans(index, node, v).empty())
+      out.push_back(v);
+  }
+  return out;
+}
+
+std::vector<float>
+BibleQuery::scoreWord(const BibleIndex &index, int word,
+                      const std::vector<quint32> &matches,
+                      qint64 frequency) const {
+  return termScores(index, wordNode(word), matches, frequency);
+}
+
+std::vector<BibleQuery::Scored>
+BibleQuery::rank(const BibleIndex &index) const {
+  if (m_root < 0)
+    return {};
+  return rank(index, evaluate(index, m_root));
+}
+
+std::vector<BibleQuery::Scored>
+BibleQuery::rank(const BibleIndex &index, const Verses &matches) const {
+  std::vector<Scored> result;
+  if (m_root < 0)
+    return result;
+  result.reserve(matches.size());
+  for (quint32 v : matches)
+    result.push_back({v, 0.0f});
+
+  std::vector<int> terms;
+  scoringNodes(m_root, terms);
+  for (int term : terms) {
+    const std::vector<float> scores =
+        termScores(index, term, matches, frequency(index, term));
+    for (size_t i = 0; i < result.size(); ++i)
+      result[i].score += scores[i];
+  }
+  return result;
+}
+
+qint64 BibleQuery::frequency(const BibleIndex &index, int node) const {
+  // A single term's posting list is its verses; anything else is evaluated
+  if (m_nodes[node].kind == Node::Term) {
+    auto [first, last] = termRange(index, m_nodes[node]);
+    if (last - first <= 1)
+      return first < last ? qint64(index.postings(first).size()) : 0;
+  }
+  return qint64(evaluate(index, node).size());
+}
+
+std::vector<float> BibleQuery::termScores(const BibleIndex &index, int term,
+                                          const Verses &matches,
+                                          qint64 frequency) const {
+  std::vector<float> scores(matches.size(), 0.0f);
+  const double df = double(frequency);
+  if (df == 0)
+    return scores;
+  const double n = index.verseCount();
+  const double averageLength = std::max(index.averageVerseLength(), 1.0);
+  const double idf = std::log(1.0 + (n - df + 0.5) / (df + 0.5));
+  for (size_t i = 0; i < matches.size(); ++i) {
+    const double tf = double(spans(index, term, matches[i]).size());
+    if (tf == 0)
+      continue;
+    const double norm =
+        kBm25K1 * (1.0 - kBm25B +
+                   kBm25B * index.verseLength(matches[i]) / averageLength);
+    scores[i] = float(idf * tf * (kBm25K1 + 1.0) / (tf + norm));
+  }
+  return scores;
+}
+
+void BibleQuery::scoringNodes(int n, std::vector<int> &out) const {
+  const Node &node = m_nodes[n];
+  switch (node.kind) {
+  case Node::Term:
+  case Node::Phrase:
+  case Node::Near:
+    out.push_back(n);
+    return;
+  case Node::And:
+  case Node::Or:
+    for (int child : node.children)
+      scoringNodes(child, out);
+    return;
+  case Node::Not:
+    return;
+  }
+}
+
+std::pair<int, int> BibleQuery::termRange(const BibleIndex &index,
+                                          const Node &node) {
+  const QByteArrayView word(node.word);
+  if (node.prefix)
+    return index.prefixTerms(word);
+  const int t = index.findTerm(word);
+  return t < 0 ? std::pair<int, int>{0, 0} : std::pair<int, int>{t, t + 1};
+}
+
+std::vector<quint32> BibleQuery::evaluate(const BibleIndex &index,
+                                          int n) const {
+  const Node &node = m_nodes[n];
+  switch (node.kind) {
+  case Node::Term: {
+    auto [first, last] = termRange(index, node);
+    if (first >= last)
+      return {};
+    if (last - first == 1) {
+      BibleIndex::Postings list = index.postings(first);
+      return Verses(list.begin(), list.end());
+    }
+    // Union the expansion through a bitmap over the verse table, so a short
+    // prefix covering many terms stays linear
+    std::vector<quint64> bits((size_t(index.verseCount()) + 63) / 64, 0);
+    for (int t = first; t < last; ++t) {
+      for (quint32 v : index.postings(t))
+        bits[v / 64] |= quint64(1) << (v % 64);
+    }
+    Verses out;
+    for (size_t w = 0; w < bits.size(); ++w) {
+      for (quint64 word = bits[w]; word; word &= word - 1)
+        out.push_back(quint32(w * 64 + qCountTrailingZeroBits(word)));
+    }
+    return out;
+  }
+
+  case Node::Phrase:
+  case Node::Near: {
+    // Verses containing every part, then check the positions
+    std::vector<Verses> parts;
+    for (int child : node.children)
+      parts.push_back(evaluate(index, child));
+    std::sort(parts.begin(), parts.end(),
+              [](const Verses &a, const Verses &b) {
+                return a.size() < b.size();
+              });
+    Verses candidates = parts.front();
+    for (size_t i = 1; i < parts.size() && !candidates.empty(); ++i)
+      candidates = intersect(candidates, parts[i]);
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                    [&](quint32 v) {
+                                      return spans(index, n, v).empty();
+                                    }),
+                     candidates.end());
+    return candidates;
+  }
+
+  case Node::And: {
+    std::vector<Verses> positive;
+    std::vector<int> negative;
+    for (int child : node.children) {
+      if (m_nodes[child].kind == Node::Not)
+        negative.push_back(m_nodes[child].children.front());
+      else
+        positive.push_back(evaluate(index, child));
+    }
+    Verses result;
+    if (positive.empty()) {
+      result = complement({}, index.verseCount());
+    } else {
+      std::sort(positive.begin(), positive.end(),
+                [](const Verses &a, const Verses &b) {
+                  return a.size() < b.size();
+                });
+      result = std::move(positive.front());
+      for (size_t i = 1; i < positive.size() && !result.empty(); ++i)
+        result = intersect(result, positive[i]);
+    }
+    for (size_t i = 0; i < negative.size() && !result.empty(); ++i)
+      result = subtract(result, evaluate(index, negative[i]));
+    return result;
+  }
+
+  case Node::Or: {
+    Verses result;
+    for (int child : node.children)
+      result = unite(result, evaluate(index, child));
+    return result;
+  }
+
+  case Node::Not:
+    return complement(evaluate(index, node.children.front()),
+                      index.verseCount());
+  }
+  return {};
+}
+
+std::vector<BibleQuery::Span> BibleQuery::spans(const BibleIndex &index, int n,
+                                                quint32 verse) const {
+  const Node &node = m_nodes[n];
+  std::vector<Span> out;
+  switch (node.kind) {
+  case Node::Term: {
+    auto [first, last] = termRange(index, node);
+    if (last - first > kMaxProbedTerms) {
+      BibleIndex::tokenize(
+          index.store().verseUtf8(int(verse)),
+          [&](QByteArrayView token, int position, qsizetype, qsizetype) {
+            if (token.startsWith(QByteArrayView(node.word)))
+              out.push_back({position, 1});
+          });
+      return out;
+    }
+    for (int t = first; t < last; ++t) {
+      for (quint16 p : index.positions(t, verse))
+        out.push_back({p, 1});
+    }
+    sortSpans(out);
+    return out;
+  }
+
+  case Node::Phrase: {
+    std::vector<std::vector<Span>> parts;
+    for (int child : node.children) {
+      parts.push_back(spans(index, child, verse));
+      if (parts.back().empty())
+        return out;
+    }
+    const int length = int(parts.size());
+    for (const Span &head : parts.front()) {
+      bool found = true;
+      for (int i = 1; i < length && found; ++i) {
+        found = std::binary_search(
+            parts[i].begin(), parts[i].end(), Span{head.start + i, 1},
+            [](const Span &a, const Span &b) { return a.start < b.start; });
+      }
+      if (found)
+        out.push_back({head.start, length});
+    }
+    return out;
+  }
+
+  case Node::Near: {
+    const std::vector<Span> a = spans(index, node.children[0], verse);
+    const std::vector<Span> b = spans(index, node.children[1], verse);
+    for (const Span &x : a) {
+      for (const Span &y : b) {
+        // Words strictly between the two spans
+        const int gap = x.start <= y.start ? y.start - (x.start + x.length)
+                                           : x.start - (y.start + y.length);
+        if (gap >= 0 && gap <= node.distance) {
+          out.push_back(x);
+          out.push_back(y);
+        }
+      }
+    }
+    sortSpans(out);
+    return out;
+  }
+
+  case Node::And:
+  case Node::Or:
+    for (int child : node.children) {
+      std::vector<Span> part = spans(index, child, verse);
+      out.insert(out.end(), part.begin(), part.end());
+    }
+    return out;
+
+  case Node::Not:
+    return out;
+  }
+  return out;
+}
+
+std::vector<std::pair<int, int>>
+BibleQuery::textRanges(QByteArrayView verseUtf8,
+                       const std::vector<Span> &spans) {
+  std::vector<std::pair<int, int>> ranges;
+  if (spans.empty())
+    return ranges;
+
+  // Byte extent of every token, and the UTF-16 offset of every byte
+  std::vector<std::pair<qsizetype, qsizetype>> tokens;
+  BibleIndex::tokenize(verseUtf8, [&](QByteArrayView, int, qsizetype offset,
+                                      qsizetype length) {
+    tokens.push_back({offset, offset + length});
+  });
+  std::vector<int> utf16(size_t(verseUtf8.size()) + 1);
+  int units = 0;
+  for (qsizetype i = 0; i < verseUtf8.size(); ++i) {
+    utf16[size_t(i)] = units;
+    const uchar c = uchar(verseUtf8[i]);
+    if ((c & 0xc0) != 0x80)
+      units += c >= 0xf0 ? 2 : 1; // Four-byte sequences are surrogate pairs
+  }
+  utf16[size_t(verseUtf8.size())] = units;
+
+  for (const Span &span : spans) {
+    if (span.start < 0 || span.start + span.length > int(tokens.size()))
+      continue;
+    const int start = utf16[size_t(tokens[size_t(span.start)].first)];
+    const int end =
+        utf16[size_t(tokens[size_t(span.start + span.length - 1)].second)];
+    // Spans arrive sorted by start; merge overlaps
+    if (!ranges.empty() && start <= ranges.back().first + ranges.back().second)
+      ranges.back().second =
+          std::max(ranges.back().second, end - ranges.back().first);
+    else
+      ranges.push_back({start, end - start});
+  }
+  return ranges;
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "BibleIndex.h"
+#include <QString>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A parsed keyword query, evaluated against a BibleIndex.
+//
+// Syntax (operators must be upper case; anything else is a word):
+//   grace faith           both words (AND is implied)
+//   grace AND faith       same
+//   grace OR mercy        either word
+//   grace NOT law         grace but not law; "-law" works too
+//   "in the beginning"    exact phrase
+//   grace NEAR/5 faith    at most 5 words apart, in either order (NEAR: 10)
+//   (grace OR mercy) law  grouping
+//   bless*                any word starting with "bless"
+// The last word of the query also matches as a prefix while it is still
+// being typed (no trailing space or closing quote).
+//
+// Parsing never fails: stray operators and unbalanced brackets are ignored.
+// A parsed query does not depend on an index and can be evaluated against
+// every loaded version.
+class BibleQuery {
+public:
+  // Run of tokens in a verse, in token positions (see BibleIndex::tokenize)
+  struct Span {
+    int start;
+    int length;
+  };
+
+  static BibleQuery parse(const QString &text);
+
+  bool isEmpty() const { return m_root < 0; }
+
+  // Indices of the matching verses, ascending (canonical order)
+  std::vector<quint32> evaluate(const BibleIndex &index) const;
+
+  // A matching verse with its BM25 relevance
+  struct Scored {
+    quint32 verse;
+    float score;
+  };
+
+  // Matching verses in canonical order, each scored with BM25. Every word,
+  // phrase or NEAR pair outside NOT is one query term; its document
+  // frequency is the number of verses it matches in this index.
+  std::vector<Scored> rank(const BibleIndex &index) const;
+  // Same, for matches already found by evaluate()
+  std::vector<Scored> rank(const BibleIndex &index,
+                           const std::vector<quint32> &matches) const;
+
+  // True for plain words ANDed together ("grace faith"). Typing more of
+  // such a query can only narrow its matches, so the words below let a
+  // caller redo just the words that changed.
+  bool isConjunction() const;
+  // Words of a conjunction (0 for other queries)
+  int wordCount() const;
+  // Whether word i is the same here and in another conjunction
+  bool sameWord(int word, const BibleQuery &other) const;
+  // Whether word i only matches words that word i of a previous conjunction
+  // matches: the same word, or one starting with the previous prefix word
+  // ("grace" after "gra*")
+  bool narrowsWord(int word, const BibleQuery &previous) const;
+  // Word i as a key for caching per-word values: the folded word, with a
+  // trailing '*' if it matches as a prefix
+  std::string wordKey(int word) const;
+  // Number of verses of index that contain word i (its document frequency)
+  qint64 wordFrequency(const BibleIndex &index, int word) const;
+  // The candidates (ascending verse indices) that contain word i. Costs
+  // per candidate, not per posting, when the candidates are few.
+  std::vector<quint32> filterWord(const BibleIndex &index, int word,
+                                  const std::vector<quint32> &candidates) const;
+  // BM25 contribution of word i, of the given wordFrequency, to each of the
+  // matches; a conjunction's rank() score is the sum over its words, in
+  // order
+  std::vector<float> scoreWord(const BibleIndex &index, int word,
+                               const std::vector<quint32> &matches,
+                               qint64 frequency) const;
+
+  // Folded words of the query that no word of index matches, for looking
+  // them up as misspellings (see BibleSpelling)
+  std::vector<std::string> unknownWords(const BibleIndex &index) const;
+  // The query with each word in alternatives also matching the words it maps
+  // to, as if "rightousness" were "(rightousness OR righteousness)"
+  BibleQuery withAlternatives(
+      const std::map<std::string, std::vector<std::string>> &alternatives)
+      const;
+
+  // Where the query's words, phrases and proximity pairs occur in a matching
+  // verse, sorted by start. Words under NOT are not reported.
+  std::vector<Span> matches(const BibleIndex &index, quint32 verse) const;
+
+  // Converts token spans of a verse to [start, length) ranges of its QString
+  // text (UTF-16 code units), for highlighting
+  static std::vector<std::pair<int, int>>
+  textRanges(QByteArrayView verseUtf8, const std::vector<Span> &spans);
+
+private:
+  struct Node {
+    enum Kind { Term, Phrase, Near, And, Or, Not };
+    explicit Node(Kind kind) : kind(kind) {}
+
+    Kind kind;
+    std::string word;     // Term: folded token
+    bool prefix = false;  // Term: match every word starting with it
+    int distance = 0;     // Near: maximum gap in words
+    std::vector<int> children;
+  };
+
+  class Parser;
+
+  // [first, last) term numbers a Term node stands for
+  static std::pair<int, int> termRange(const BibleIndex &index,
+                                       const Node &node);
+
+  std::vector<quint32> evaluate(const BibleIndex &index, int node) const;
+  // Node of word i of a conjunction
+  int wordNode(int word) const;
+  // Number of verses of index one scoring node matches
+  qint64 frequency(const BibleIndex &index, int node) const;
+  // BM25 contribution of one scoring node, matching frequency verses of
+  // index, to each of the matches
+  std::vector<float> termScores(const BibleIndex &index, int node,
+                                const std::vector<quint32> &matches,
+                                qint64 frequency) const;
+  // Term, Phrase and Near nodes that are not under a Not
+  void scoringNodes(int node, std::vector<int> &out) const;
+  std::vector<Span> spans(const BibleIndex &index, int node,
+                          quint32 verse) const;
+
+  std::vector<Node> m_nodes;
+  int m_root = -1;
+};
@@ -0,0 +1,246 @@
+#include "BibleReference.h"
+#include "BibleBooks.h"
+#include <algorithm>
+
+namespace Bible {
+namespace {
+constexpr int kMaxNumber = 0xff; // Chapters and verses fit a VerseId byte
+
+bool isDigit(QChar c) { return c.unicode() >= '0' && c.unicode() <= '9'; }
+
+bool isDash(QChar c) {
+  // Hyphen, en dash, em dash
+  return c.unicode() == '-' || c.unicode() == 0x2013 || c.unicode() == 0x2014;
+}
+
+// Reads a reference list left to right
+class Scanner {
+public:
+  explicit Scanner(QStringView text) : m_text(text) {}
+
+  bool atEnd() {
+    skipSpaces();
+    return m_pos == m_text.size();
+  }
+
+  bool accept(char16_t c) {
+    skipSpaces();
+    if (m_pos < m_text.size() && m_text[m_pos].unicode() == c) {
+      ++m_pos;
+      return true;
+    }
+    return false;
+  }
+
+  bool acceptDash() {
+    skipSpaces();
+    if (m_pos < m_text.size() && isDash(m_text[m_pos])) {
+      ++m_pos;
+      return true;
+    }
+    return false;
+  }
+
+  // ':' between chapter and verse; '.' too when a digit follows
+  bool acceptVerseSeparator() {
+    if (accept(':'))
+      return true;
+    skipSpaces();
+    if (m_pos + 1 < m_text.size() && m_text[m_pos].unicode() == '.' &&
+        isDigit(m_text[m_pos + 1])) {
+      ++m_pos;
+      return true;
+    }
+    return false;
+  }
+
+  // A chapter or verse number, -1 if there is none here. Too large numbers
+  // come back as kMaxNumber + 1.
+  int number() {
+    skipSpaces();
+    if (m_pos == m_text.size() || !isDigit(m_text[m_pos]))
+      return -1;
+    int value = 0;
+    while (m_pos < m_text.size() && isDigit(m_text[m_pos])) {
+      value = std::min(value * 10 + (m_text[m_pos].unicode() - '0'),
+                       kMaxNumber + 1);
+      ++m_pos;
+    }
+    return value;
+  }
+
+  // A book name ("John", "1 Cor.", "Mambo ya Walawi"): its canonical number,
+  // 0 if no name starts here, or -1 if one does but is not a book
+  int book() {
+    skipSpaces();
+    const qsizetype start = m_pos;
+    qsizetype pos = m_pos;
+    if (pos < m_text.size() && isDigit(m_text[pos])) {
+      ++pos; // "1 John"; a longer number is a chapter or verse
+      while (pos < m_text.size() && m_text[pos].isSpace())
+        ++pos;
+    }
+    if (pos == m_text.size() || !m_text[pos].isLetter())
+      return 0;
+
+    // Words of letters (and abbreviation dots), as long as they last
+    qsizetype end = pos;
+    while (pos < m_text.size() && m_text[pos].isLetter()) {
+      while (pos < m_text.size() &&
+             (m_text[pos].isLetter() || m_text[pos].unicode() == '.'))
+        ++pos;
+      end = pos;
+      while (pos < m_text.size() && m_text[pos].isSpace())
+        ++pos;
+    }
+    m_pos = end;
+
+    const BookLookup found = lookupBookName(m_text.sliced(start, end - start));
+    if (found.match != BookMatch::Exact && found.match != BookMatch::Prefix)
+      return -1;
+    return found.book;
+  }
+
+private:
+  void skipSpaces() {
+    while (m_pos < m_text.size() && m_text[m_pos].isSpace())
+      ++m_pos;
+  }
+
+  QStringView m_text;
+  qsizetype m_pos = 0;
+};
+
+bool validChapter(int chapter) { return chapter >= 1 && chapter <= kMaxNumber; }
+bool validVerse(int verse) { return verse >= 1 && verse <= kMaxNumber; }
+} // namespace
+
+bool parseReferences(QStringView text, std::vector<VerseRange> &ranges) {
+  const size_t initialSize = ranges.size();
+  auto fail = [&] {
+    ranges.resize(initialSize);
+    return false;
+  };
+
+  Scanner scanner(text);
+  int book = 0;
+  int chapter = 0;     // Last chapter referenced
+  bool verses = false; // Whether the last reference had verses
+  char16_t separator = 0;
+  while (true) {
+    const int named = scanner.book();
+    if (named < 0)
+      return fail();
+    if (named > 0) {
+      book = named;
+      chapter = 0;
+      verses = false;
+    } else if (book == 0) {
+      return fail();
+    }
+
+    const int n = scanner.number();
+    if (n < 0) {
+      if (named == 0)
+        return fail(); // Stray separator
+      // Book alone
+      ranges.push_back(
+          {makeVerseId(book, 1, 0), makeVerseId(book, 1, kMaxNumber)});
+    } else {
+      // Start: chapter and verse (0 for the start of the chapter)
+      int startChapter = n;
+      int startVerse = 0;
+      if (scanner.acceptVerseSeparator()) {
+        startVerse = scanner.number();
+        if (startVerse < 0) {
+          if (!scanner.atEnd())
+            return fail();
+          startVerse = 0; // "John 3:" while typing
+        } else if (!validVerse(startVerse)) {
+          return fail();
+        }
+      } else if (named == 0 && separator == ',' && verses) {
+        startChapter = chapter;
+        startVerse = n; // "John 3:16, 18"
+      } else if (kCanonicalBooks[book - 1].chapters == 1) {
+        startChapter = 1;
+        startVerse = n; // "Jude 3"
+      }
+      if (!validChapter(startChapter))
+        return fail();
+
+      // End: same as the start unless a range follows
+      int endChapter = startChapter;
+      int endVerse = startVerse > 0 ? startVerse : kMaxNumber;
+      if (scanner.acceptDash()) {
+        const int m = scanner.number();
+        if (m < 0) {
+          if (!scanner.atEnd())
+            return fail(); // "John 3:16-" while typing
+        } else if (scanner.acceptVerseSeparator()) {
+          endChapter = m; // "1 Cor 13:4-14:1"
+          endVerse = scanner.number();
+          if (endVerse < 0) {
+            if (!scanner.atEnd())
+              return fail();
+            endVerse = kMaxNumber;
+          }
+        } else if (startVerse > 0) {
+          endVerse = m; // "John 3:16-18"
+        } else {
+          endChapter = m; // "Ps 23-24"
+        }
+        if (!validChapter(endChapter) || endVerse < 1 || endVerse > kMaxNumber)
+          return fail();
+      }
+
+      const VerseId first = makeVerseId(book, startChapter, startVerse);
+      const VerseId last = makeVerseId(book, endChapter, endVerse);
+      if (last < first)
+        return fail();
+      ranges.push_back({first, last});
+      chapter = endChapter;
+      verses = startVerse > 0;
+    }
+
+    if (scanner.atEnd())
+      break;
+    if (scanner.accept(','))
+      separator = ',';
+    else if (scanner.accept(';'))
+      separator = ';';
+    else
+      return fail();
+    if (scanner.atEnd())
+      break; // "John 3:16," while typing
+  }
+  return true;
+}
+
+void findReferences(QStringView text, std::vector<FoundReference> &out) {
+  std::vector<BookMention> names;
+  findBookNames(text, names);
+  std::vector<VerseRange> ranges;
+  for (size_t n = 0; n < names.size(); ++n) {
+    const qsizetype start = names[n].start;
+    const qsizetype limit =
+        n + 1 < names.size() ? names[n + 1].start : text.size();
+    qsizetype pos = start + names[n].length;
+    while (pos < limit &&
+           (isDigit(text[pos]) || isDash(text[pos]) || text[pos].isSpace() ||
+            text[pos].unicode() == ':' || text[pos].unicode() == '.' ||
+            text[pos].unicode() == ',' || text[pos].unicode() == ';'))
+      ++pos;
+    // Longest reference ending in a number ("John 3:16" of "John 3:16. In")
+    for (qsizetype end = pos; end > start + names[n].length; --end) {
+      if (!isDigit(text[end - 1]) || (end < text.size() && isDigit(text[end])))
+        continue;
+      ranges.clear();
+      if (parseReferences(text.sliced(start, end - start), ranges)) {
+        out.push_back({start, end - start, ranges});
+        break;
+      }
+    }
+  }
+}
+} // namespace Bible
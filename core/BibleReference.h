@@ -0,0 +1,46 @@
+#pragma once
+#include "BibleStore.h"
+#include <QStringView>
+#include <vector>
+
+namespace Bible {
+// Inclusive range of verse ids. A whole chapter runs from verse 0 to 0xff, so
+// a range can be looked up with BibleStore::lowerBound whatever verses exist.
+struct VerseRange {
+  VerseId first;
+  VerseId last;
+};
+
+// Parses a typed scripture reference or list of references:
+//   John 3:16            one verse ("John 3.16" works too)
+//   John 3:16-18, 20     a range, then another verse of the same chapter
+//   John 3:16-18, 4:1-3  ... or a range in another chapter
+//   1 Cor 13:4-14:1      a range across chapters
+//   Ps 23; Rom 8:28      a whole chapter; a new book may follow ',' or ';'
+//   Ps 23-24             a range of chapters
+//   Gen                  a book alone stands for its first chapter
+// A bare number after ';' is a chapter; after ',' it is a verse if the
+// previous reference had verses. In one-chapter books ("Jude 3") it is always
+// a verse. A trailing separator, ':' or '-' is ignored so references can be
+// resolved while they are being typed. Book names are resolved with
+// lookupBookName, so only canonical books are found.
+//
+// Appends one range per reference, in the order typed, and returns true if
+// all of text is a reference list; otherwise ranges is left as it was.
+// Works on the text in place: no regexes and no temporary strings.
+bool parseReferences(QStringView text, std::vector<VerseRange> &ranges);
+
+// A scripture reference found in running text
+struct FoundReference {
+  qsizetype start; // In the text
+  qsizetype length;
+  std::vector<VerseRange> ranges;
+};
+
+// Finds the scripture references in running text ("as John 3:16-18, 20 and
+// Rom 8:28 say"): each book name findBookNames finds, with as much of the
+// numbers and separators after it as parseReferences accepts, up to the next
+// book name. A name with no chapter after it is left out, as "Mark" and
+// "Job" in prose seldom are references. Appends them to out in text order.
+void findReferences(QStringView text, std::vector<FoundReference> &out);
+} // namespace Bible
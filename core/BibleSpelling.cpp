@@ -0,0 +1,150 @@
+#include "BibleSpelling.h"
+#include "BibleIndex.h"
+#include <algorithm>
+#include <cstdlib>
+#include <tuple>
+
+namespace {
+// Distinct trigrams of a word padded with NULs, sorted, each packed into
+// the low 24 bits of a quint32
+void trigrams(QByteArrayView word, std::vector<quint32> &out) {
+  out.clear();
+  const qsizetype n = word.size();
+  auto at = [&](qsizetype i) {
+    return i < 1 || i > n ? quint32(0) : quint32(uchar(word[i - 1]));
+  };
+  for (qsizetype i = 0; i < n; ++i)
+    out.push_back(at(i) << 16 | at(i + 1) << 8 | at(i + 2));
+  std::sort(out.begin(), out.end());
+  out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+// Edit distance between a and b, counting an adjacent transposition as one
+// edit, or limit + 1 once it is certain to exceed limit. Counts bytes, so
+// a mistyped non-ASCII letter can cost two.
+int editDistance(QByteArrayView a, QByteArrayView b, int limit) {
+  const qsizetype m = a.size();
+  const qsizetype n = b.size();
+  if (std::abs(m - n) > limit)
+    return limit + 1;
+  // Three rows of the dynamic programming table: two back, previous, current
+  std::vector<int> rows(size_t(3 * (n + 1)));
+  int *before = rows.data();
+  int *previous = before + n + 1;
+  int *current = previous + n + 1;
+  for (qsizetype j = 0; j <= n; ++j)
+    previous[j] = int(j);
+  for (qsizetype i = 1; i <= m; ++i) {
+    current[0] = int(i);
+    int best = current[0];
+    for (qsizetype j = 1; j <= n; ++j) {
+      const int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+      int d = std::min({previous[j] + 1, current[j - 1] + 1,
+                        previous[j - 1] + cost});
+      if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1])
+        d = std::min(d, before[j - 2] + 1);
+      current[j] = d;
+      best = std::min(best, d);
+    }
+    if (best > limit)
+      return limit + 1;
+    std::tie(before, previous, current) =
+        std::make_tuple(previous, current, before);
+  }
+  return std::min(previous[n], limit + 1);
+}
+} // namespace
+
+std::unique_ptr<BibleSpelling> BibleSpelling::build(const BibleIndex &index) {
+  // (trigram, term) pairs, sorted into one posting list per trigram
+  std::vector<quint64> pairs;
+  std::vector<quint32> grams;
+  for (int t = 0; t < index.termCount(); ++t) {
+    trigrams(index.term(t), grams);
+    for (quint32 gram : grams)
+      pairs.push_back(quint64(gram) << 32 | quint32(t));
+  }
+  std::sort(pairs.begin(), pairs.end());
+
+  std::unique_ptr<BibleSpelling> spelling(new BibleSpelling());
+  spelling->m_index = &index;
+  spelling->m_gramTerms.reserve(pairs.size());
+  for (quint64 pair : pairs) {
+    const quint32 gram = quint32(pair >> 32);
+    if (spelling->m_grams.empty() || spelling->m_grams.back() != gram) {
+      spelling->m_grams.push_back(gram);
+      spelling->m_gramOffsets.push_back(
+          quint32(spelling->m_gramTerms.size()));
+    }
+    spelling->m_gramTerms.push_back(quint32(pair));
+  }
+  spelling->m_gramOffsets.push_back(quint32(spelling->m_gramTerms.size()));
+  spelling->m_grams.shrink_to_fit();
+  spelling->m_gramOffsets.shrink_to_fit();
+  return spelling;
+}
+
+int BibleSpelling::maxEdits(qsizetype length) {
+  if (length < 4)
+    return 0;
+  return length < 7 ? 1 : 2;
+}
+
+std::vector<int> BibleSpelling::suggest(QByteArrayView word,
+                                        size_t limit) const {
+  const int limitEdits = maxEdits(word.size());
+  if (limitEdits == 0 || limit == 0 || m_index->findTerm(word) >= 0)
+    return {};
+
+  // Trigrams each term shares with the word; a term within limitEdits
+  // edits shares all but at most four per edit (a transposition)
+  std::vector<quint32> grams;
+  trigrams(word, grams);
+  std::vector<quint8> shared(size_t(m_index->termCount()), 0);
+  std::vector<int> touched;
+  for (quint32 gram : grams) {
+    auto it = std::lower_bound(m_grams.begin(), m_grams.end(), gram);
+    if (it == m_grams.end() || *it != gram)
+      continue;
+    const size_t g = size_t(it - m_grams.begin());
+    for (quint32 i = m_gramOffsets[g]; i < m_gramOffsets[g + 1]; ++i) {
+      const quint32 t = m_gramTerms[i];
+      if (shared[t]++ == 0)
+        touched.push_back(int(t));
+    }
+  }
+  const int needed = int(grams.size()) - 4 * limitEdits;
+
+  struct Candidate {
+    int edits;
+    int frequency;
+    int term;
+  };
+  std::vector<Candidate> found;
+  int closest = limitEdits;
+  for (int t : touched) {
+    if (shared[size_t(t)] < needed)
+      continue;
+    const int edits = editDistance(word, m_index->term(t), closest);
+    if (edits > closest)
+      continue;
+    closest = edits;
+    found.push_back({edits, m_index->postings(t).size(), t});
+  }
+  // Only the closest spellings; "rightousness" is "righteousness", not also
+  // every word two edits away
+  found.erase(std::remove_if(found.begin(), found.end(),
+                             [closest](const Candidate &candidate) {
+                               return candidate.edits > closest;
+                             }),
+              found.end());
+  std::sort(found.begin(), found.end(),
+            [](const Candidate &a, const Candidate &b) {
+              return std::tie(b.frequency, a.term) <
+                     std::tie(a.frequency, b.term);
+            });
+  std::vector<int> terms;
+  for (size_t i = 0; i < found.size() && i < limit; ++i)
+    terms.push_back(found[i].term);
+  return terms;
+}
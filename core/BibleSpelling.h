@@ -0,0 +1,46 @@
+#pragma once
+#include <QByteArrayView>
+#include <memory>
+#include <vector>
+
+class BibleIndex;
+
+// Trigram index over the words (terms) of one BibleIndex, for looking up
+// misspelled query words: "rightousness" finds "righteousness".
+//
+// Each term is split into the byte trigrams of the term padded with a NUL
+// at either end, so a term of n bytes has n of them. A word's candidates
+// are the terms sharing enough of its trigrams to be within reach, since
+// one edit changes at most four; only those are verified with a bounded
+// edit distance.
+class BibleSpelling {
+public:
+  // Indexes every term of the index, which must outlive this. Runs on a
+  // loader thread.
+  static std::unique_ptr<BibleSpelling> build(const BibleIndex &index);
+
+  // Edits allowed for a folded word of length bytes: none for short words,
+  // which are too easily turned into other words
+  static int maxEdits(qsizetype length);
+
+  // Terms within maxEdits() edits (insertions, deletions, substitutions and
+  // transpositions of adjacent bytes) of a folded word, keeping only the
+  // closest ones, most frequent first, at most limit of them. Empty if the
+  // word is a term itself.
+  std::vector<int> suggest(QByteArrayView word, size_t limit) const;
+
+  // Heap memory held by the index
+  qint64 memoryBytes() const {
+    return qint64((m_grams.capacity() + m_gramOffsets.capacity() +
+                   m_gramTerms.capacity()) *
+                  sizeof(quint32));
+  }
+
+private:
+  BibleSpelling() = default;
+
+  const BibleIndex *m_index = nullptr;
+  std::vector<quint32> m_grams;       // Distinct trigrams, sorted
+  std::vector<quint32> m_gramOffsets; // gram -> offset in m_gramTerms
+  std::vector<quint32> m_gramTerms;   // Ascending term numbers per trigram
+};
@@ -0,0 +1,211 @@
+#include "BibleStore.h"
+#include <QDebug>
+#include <QFile>
+#include <algorithm>
+#include <cstring>
+
+BibleStore::~BibleStore() = default;
+
+std::unique_ptr<BibleStore> BibleStore::fromBuffer(QByteArray image) {
+  std::unique_ptr<BibleStore> store(new BibleStore());
+  store->m_buffer = std::move(image);
+  if (!store->attach(store->m_buffer.constData(), store->m_buffer.size()))
+    return nullptr;
+  return store;
+}
+
+std::unique_ptr<BibleStore> BibleStore::fromFile(std::unique_ptr<QFile> file) {
+  if (!file || !file->isOpen())
+    return nullptr;
+
+  qint64 size = file->size();
+  if (size < qint64(sizeof(ImageHeader)))
+    return nullptr;
+
+  const uchar *data = file->map(0, size);
+  if (!data)
+    return nullptr;
+
+  std::unique_ptr<BibleStore> store(new BibleStore());
+  store->m_file = std::move(file);
+  if (!store->attach(reinterpret_cast<const char *>(data), size))
+    return nullptr;
+  return store;
+}
+
+// Checks the structure of the image. Everything here is proportional to the
+// book and verse tables; the text blob itself is never touched.
+bool BibleStore::attach(const char *data, qint64 size) {
+  if (size < qint64(sizeof(ImageHeader)) ||
+      reinterpret_cast<quintptr>(data) % alignof(quint32) != 0)
+    return false;
+
+  m_header = reinterpret_cast<const ImageHeader *>(data);
+  m_size = size;
+  if (std::memcmp(m_header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      m_header->formatVersion != kFormatVersion ||
+      m_header->importerVersion != kImporterVersion)
+    return false;
+
+  const qint64 books = m_header->bookCount;
+  const qint64 verses = m_header->verseCount;
+  if (books > 0xffff)
+    return false;
+  const qint64 expected = qint64(sizeof(ImageHeader)) +
+                          books * qint64(sizeof(BookEntry)) +
+                          verses * qint64(sizeof(VerseId)) +
+                          (verses + 1) * qint64(sizeof(quint32)) +
+                          m_header->blobSize;
+  if (expected != size)
+    return false;
+
+  const char *p = data + sizeof(ImageHeader);
+  m_books = reinterpret_cast<const BookEntry *>(p);
+  p += books * sizeof(BookEntry);
+  m_ids = reinterpret_cast<const VerseId *>(p);
+  p += verses * sizeof(VerseId);
+  m_offsets = reinterpret_cast<const quint32 *>(p);
+  p += (verses + 1) * sizeof(quint32);
+  m_blob = p;
+
+  // Text offsets must be monotonic and end exactly at the names section
+  if (m_offsets[0] != 0)
+    return false;
+  for (qint64 i = 0; i < verses; ++i) {
+    if (m_offsets[i + 1] < m_offsets[i])
+      return false;
+  }
+  if (m_offsets[verses] > m_header->blobSize)
+    return false;
+
+  // Books must tile the verse table in order, and every verse id must be
+  // strictly increasing and belong to its book
+  quint32 next = 0;
+  for (qint64 b = 0; b < books; ++b) {
+    const BookEntry &entry = m_books[b];
+    if (entry.firstVerse != next ||
+        quint64(entry.nameOffset) + entry.nameLength > m_header->blobSize)
+      return false;
+    next += entry.verseCount;
+    if (next > verses)
+      return false;
+    for (quint32 i = entry.firstVerse; i < next; ++i) {
+      if (verseIdBook(m_ids[i]) != b + 1)
+        return false;
+      if (i > 0 && m_ids[i] <= m_ids[i - 1])
+        return false;
+    }
+  }
+  if (next != verses)
+    return false;
+
+  buildTables();
+  return true;
+}
+
+void BibleStore::buildTables() {
+  const int books = bookCount();
+  const int verses = verseCount();
+
+  m_chapterBase.assign(books + 2, 0);
+  m_chapterCounts.assign(books + 1, 0);
+  for (int book = 1; book <= books; ++book) {
+    const BookEntry &entry = m_books[book - 1];
+    int rows = 0;
+    if (entry.verseCount > 0)
+      rows = verseIdChapter(m_ids[entry.firstVerse + entry.verseCount - 1]) + 1;
+    m_chapterBase[book + 1] = m_chapterBase[book] + quint32(rows);
+  }
+
+  const quint32 rows = m_chapterBase[books + 1];
+  m_rowFirst.assign(rows + 1, quint32(verses));
+  m_slotBase.assign(rows + 1, 0);
+
+  int i = 0;
+  for (int book = 1; book <= books; ++book) {
+    for (quint32 row = m_chapterBase[book]; row < m_chapterBase[book + 1];
+         ++row) {
+      const int chapter = int(row - m_chapterBase[book]);
+      m_rowFirst[row] = quint32(i);
+      int maxVerse = -1;
+      while (i < verses && verseIdBook(m_ids[i]) == book &&
+             verseIdChapter(m_ids[i]) == chapter) {
+        maxVerse = verseIdVerse(m_ids[i]);
+        ++i;
+      }
+      if (maxVerse >= 0)
+        ++m_chapterCounts[book];
+      m_slotBase[row + 1] = m_slotBase[row] + quint32(maxVerse + 1);
+    }
+  }
+
+  m_slots.assign(m_slotBase[rows], -1);
+  for (int v = 0; v < verses; ++v) {
+    const VerseId id = m_ids[v];
+    const quint32 row = m_chapterBase[verseIdBook(id)] + verseIdChapter(id);
+    m_slots[m_slotBase[row] + verseIdVerse(id)] = v;
+  }
+}
+
+QString BibleStore::bookName(int book) const {
+  if (book < 1 || book > bookCount())
+    return QString();
+  const BookEntry &entry = m_books[book - 1];
+  return QString::fromUtf8(m_blob + entry.nameOffset, entry.nameLength);
+}
+
+QString BibleStore::verseText(int index) const {
+  if (index < 0 || index >= verseCount())
+    return QString();
+  return QString::fromUtf8(m_blob + m_offsets[index],
+                           m_offsets[index + 1] - m_offsets[index]);
+}
+
+int BibleStore::find(VerseId id) const {
+  const int book = verseIdBook(id);
+  if (book < 1 || book > bookCount())
+    return -1;
+  const quint32 row = m_chapterBase[book] + quint32(verseIdChapter(id));
+  if (row >= m_chapterBase[book + 1])
+    return -1;
+  const quint32 slot = m_slotBase[row] + quint32(verseIdVerse(id));
+  if (slot >= m_slotBase[row + 1])
+    return -1;
+  return m_slots[slot];
+}
+
+int BibleStore::lowerBound(VerseId id) const {
+  return int(std::lower_bound(m_ids, m_ids + verseCount(), id) - m_ids);
+}
+
+std::pair<int, int> BibleStore::bookRange(int book) const {
+  if (book < 1 || book > bookCount())
+    return {0, 0};
+  const BookEntry &entry = m_books[book - 1];
+  return {int(entry.firstVerse), int(entry.firstVerse + entry.verseCount)};
+}
+
+std::pair<int, int> BibleStore::chapterRange(int book, int chapter) const {
+  if (book < 1 || book > bookCount())
+    return {0, 0};
+  const quint32 row = m_chapterBase[book] + quint32(chapter);
+  if (chapter < 0 || row >= m_chapterBase[book + 1]) {
+    int first = int(m_books[book - 1].firstVerse);
+    return {first, first};
+  }
+  return {int(m_rowFirst[row]), int(m_rowFirst[row + 1])};
+}
+
+int BibleStore::chapterCount(int book) const {
+  if (book < 1 || book > bookCount())
+    return 0;
+  return m_chapterCounts[book];
+}
+
+qint64 BibleStore::tableBytes() const {
+  return qint64(m_chapterBase.capacity() * sizeof(quint32) +
+                m_rowFirst.capacity() * sizeof(quint32) +
+                m_slotBase.capacity() * sizeof(quint32) +
+                m_slots.capacity() * sizeof(qint32) +
+                m_chapterCounts.capacity() * sizeof(quint16));
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class QFile;
+
+// Packed verse identifier: book << 16 | chapter << 8 | verse.
+// Ordering by VerseId is book/chapter/verse order.
+using VerseId = quint32;
+
+constexpr VerseId makeVerseId(int book, int chapter, int verse) {
+  return (VerseId(book) << 16) | (VerseId(chapter & 0xff) << 8) |
+         VerseId(verse & 0xff);
+}
+constexpr int verseIdBook(VerseId id) { return int(id >> 16); }
+constexpr int verseIdChapter(VerseId id) { return int((id >> 8) & 0xff); }
+constexpr int verseIdVerse(VerseId id) { return int(id & 0xff); }
+
+// Read-only view over a compiled Bible image.
+//
+// Layout (native byte order, every section 4-byte aligned):
+//   ImageHeader | BookEntry[bookCount] | VerseId[verseCount]
+//   | quint32 textOffset[verseCount + 1] | UTF-8 blob (verse texts, names)
+//
+// Books are numbered canonically (Bible::kCanonicalBooks, then any
+// non-canonical books), so the verse table is one array in canonical order
+// and the book table is indexed directly by book number (missing books have
+// no verses). The image is either memory-mapped from the cache file or held
+// in a QByteArray when the cache could not be written.
+class BibleStore {
+public:
+  static constexpr char kMagic[8] = "CPBIBLE";
+  // Bump whenever the layout or the book numbering changes
+  static constexpr quint32 kFormatVersion = 2;
+  // Bump whenever the importer reads the same XML differently: how book
+  // names are normalized and numbered, how markup is recovered
+  static constexpr quint32 kImporterVersion = 2;
+
+  struct ImageHeader {
+    char magic[8];         // kMagic
+    quint32 formatVersion; // kFormatVersion
+    quint32 bookCount;
+    quint32 verseCount;
+    quint32 blobSize;
+    qint64 sourceSize;    // Size of the XML the image was built from
+    qint64 sourceMtime;   // Its mtime in ms since epoch
+    char sourceHash[20];  // Its SHA-1
+    quint32 importerVersion; // kImporterVersion
+  };
+  static_assert(sizeof(ImageHeader) == 64, "ImageHeader must stay packed");
+
+  struct BookEntry {
+    quint32 nameOffset; // Localized name in the blob
+    quint32 nameLength;
+    quint32 firstVerse; // Index into the verse table
+    quint32 verseCount;
+  };
+
+  ~BibleStore();
+
+  // Both factories validate the image structure and return nullptr if it is
+  // truncated or inconsistent, or was built by another format or importer
+  // version.
+  static std::unique_ptr<BibleStore> fromBuffer(QByteArray image);
+  static std::unique_ptr<BibleStore> fromFile(std::unique_ptr<QFile> file);
+
+  const ImageHeader &header() const { return *m_header; }
+
+  int bookCount() const { return int(m_header->bookCount); }
+  QString bookName(int book) const;
+
+  int verseCount() const { return int(m_header->verseCount); }
+  VerseId verseId(int index) const { return m_ids[index]; }
+  QString verseText(int index) const;
+  // Raw UTF-8 of a verse, pointing into the image (no copy)
+  QByteArrayView verseUtf8(int index) const {
+    return QByteArrayView(m_blob + m_offsets[index],
+                          m_offsets[index + 1] - m_offsets[index]);
+  }
+
+  // Index of the verse with this id, or -1. O(1).
+  int find(VerseId id) const;
+  // Index of the first verse whose id is not less than id (verseCount() if
+  // there is none). O(log n).
+  int lowerBound(VerseId id) const;
+
+  // [first, last) verse indices of a book or a chapter. O(1); a chapter is
+  // always one contiguous run of the verse table.
+  std::pair<int, int> bookRange(int book) const;
+  std::pair<int, int> chapterRange(int book, int chapter) const;
+
+  // Number of chapters that actually have verses
+  int chapterCount(int book) const;
+
+  // Size of the image, and whether it is memory-mapped from the cache (its
+  // pages are then file-backed and only resident once read)
+  qint64 imageSize() const { return m_size; }
+  bool isMapped() const { return m_file != nullptr; }
+  // Heap memory of the lookup tables built at load
+  qint64 tableBytes() const;
+
+private:
+  BibleStore() = default;
+  bool attach(const char *data, qint64 size);
+  void buildTables();
+
+  QByteArray m_buffer;          // Owning storage when not mapped
+  std::unique_ptr<QFile> m_file; // Owns the mapping when mapped
+
+  const ImageHeader *m_header = nullptr;
+  const BookEntry *m_books = nullptr;
+  const VerseId *m_ids = nullptr;
+  const quint32 *m_offsets = nullptr;
+  const char *m_blob = nullptr;
+  qint64 m_size = 0;
+
+  // Dense lookup tables derived from the verse-ID table at load time. A
+  // "row" is one (book, chapter) pair; rows of a book are consecutive and
+  // cover chapters 0..max, slots of a row cover verses 0..max.
+  std::vector<quint32> m_chapterBase;   // book -> first row
+  std::vector<quint32> m_rowFirst;      // row -> first verse index
+  std::vector<quint32> m_slotBase;      // row -> first slot
+  std::vector<qint32> m_slots;          // slot -> verse index or -1
+  std::vector<quint16> m_chapterCounts; // book -> chapters with verses
+};
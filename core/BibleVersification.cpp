@@ -0,0 +1,119 @@
+#include "BibleVersification.h"
+#include <algorithm>
+
+namespace Bible {
+namespace {
+// count verses starting at local in the Hebrew numbering are the ones
+// starting at shared in the English numbering. marker is a verse only the
+// Hebrew numbering has; a version uses the row if it has that verse. A
+// partial row maps a shared verse into part of a local one (Isaiah 64:1 is
+// the end of 63:19), so that local verse keeps its own shared id.
+struct Shift {
+  VerseId marker;
+  VerseId shared;
+  VerseId local;
+  int count;
+  bool partial = false;
+};
+
+constexpr VerseId v(int book, int chapter, int verse) {
+  return makeVerseId(book, chapter, verse);
+}
+
+constexpr Shift kHebrewShifts[] = {
+    {v(1, 32, 33), v(1, 31, 55), v(1, 32, 1), 1}, // Genesis
+    {v(1, 32, 33), v(1, 32, 1), v(1, 32, 2), 32},
+    {v(2, 7, 29), v(2, 8, 1), v(2, 7, 26), 4}, // Exodus
+    {v(2, 7, 29), v(2, 8, 5), v(2, 8, 1), 28},
+    {v(2, 21, 37), v(2, 22, 1), v(2, 21, 37), 1},
+    {v(2, 21, 37), v(2, 22, 2), v(2, 22, 1), 30},
+    {v(3, 5, 26), v(3, 6, 1), v(3, 5, 20), 7}, // Leviticus
+    {v(3, 5, 26), v(3, 6, 8), v(3, 6, 1), 23},
+    {v(4, 17, 28), v(4, 16, 36), v(4, 17, 1), 15}, // Numbers
+    {v(4, 17, 28), v(4, 17, 1), v(4, 17, 16), 13},
+    {v(4, 30, 17), v(4, 29, 40), v(4, 30, 1), 1},
+    {v(4, 30, 17), v(4, 30, 1), v(4, 30, 2), 16},
+    {v(5, 13, 19), v(5, 12, 32), v(5, 13, 1), 1}, // Deuteronomy
+    {v(5, 13, 19), v(5, 13, 1), v(5, 13, 2), 18},
+    {v(5, 23, 26), v(5, 22, 30), v(5, 23, 1), 1},
+    {v(5, 23, 26), v(5, 23, 1), v(5, 23, 2), 25},
+    {v(5, 28, 69), v(5, 29, 1), v(5, 28, 69), 1},
+    {v(5, 28, 69), v(5, 29, 2), v(5, 29, 1), 28},
+    {v(9, 24, 23), v(9, 23, 29), v(9, 24, 1), 1}, // 1 Samuel
+    {v(9, 24, 23), v(9, 24, 1), v(9, 24, 2), 22},
+    {v(10, 19, 44), v(10, 18, 33), v(10, 19, 1), 1}, // 2 Samuel
+    {v(10, 19, 44), v(10, 19, 1), v(10, 19, 2), 43},
+    {v(11, 5, 32), v(11, 4, 21), v(11, 5, 1), 14}, // 1 Kings
+    {v(11, 5, 32), v(11, 5, 1), v(11, 5, 15), 18},
+    {v(12, 12, 22), v(12, 11, 21), v(12, 12, 1), 1}, // 2 Kings
+    {v(12, 12, 22), v(12, 12, 1), v(12, 12, 2), 21},
+    {v(13, 5, 41), v(13, 6, 1), v(13, 5, 27), 15}, // 1 Chronicles
+    {v(13, 5, 41), v(13, 6, 16), v(13, 6, 1), 66},
+    {v(16, 3, 38), v(16, 4, 1), v(16, 3, 33), 6}, // Nehemiah
+    {v(16, 3, 38), v(16, 4, 7), v(16, 4, 1), 17},
+    {v(16, 10, 40), v(16, 9, 38), v(16, 10, 1), 1},
+    {v(16, 10, 40), v(16, 10, 1), v(16, 10, 2), 39},
+    {v(18, 40, 32), v(18, 41, 1), v(18, 40, 25), 8}, // Job
+    {v(18, 40, 32), v(18, 41, 9), v(18, 41, 1), 26},
+    {v(21, 4, 17), v(21, 5, 1), v(21, 4, 17), 1}, // Ecclesiastes
+    {v(21, 4, 17), v(21, 5, 2), v(21, 5, 1), 19},
+    {v(22, 7, 14), v(22, 6, 13), v(22, 7, 1), 1}, // Song of Solomon
+    {v(22, 7, 14), v(22, 7, 1), v(22, 7, 2), 13},
+    {v(23, 8, 23), v(23, 9, 1), v(23, 8, 23), 1}, // Isaiah
+    {v(23, 8, 23), v(23, 9, 2), v(23, 9, 1), 20},
+    {v(23, 8, 23), v(23, 64, 1), v(23, 63, 19), 1, true},
+    {v(23, 8, 23), v(23, 64, 2), v(23, 64, 1), 11},
+    {v(24, 8, 23), v(24, 9, 1), v(24, 8, 23), 1}, // Jeremiah
+    {v(24, 8, 23), v(24, 9, 2), v(24, 9, 1), 25},
+    {v(26, 21, 37), v(26, 20, 45), v(26, 21, 1), 5}, // Ezekiel
+    {v(26, 21, 37), v(26, 21, 1), v(26, 21, 6), 32},
+    {v(27, 3, 31), v(27, 4, 1), v(27, 3, 31), 3}, // Daniel
+    {v(27, 3, 31), v(27, 4, 4), v(27, 4, 1), 34},
+    {v(27, 6, 29), v(27, 5, 31), v(27, 6, 1), 1},
+    {v(27, 6, 29), v(27, 6, 1), v(27, 6, 2), 28},
+    {v(28, 2, 25), v(28, 1, 10), v(28, 2, 1), 2}, // Hosea
+    {v(28, 2, 25), v(28, 2, 1), v(28, 2, 3), 23},
+    {v(28, 12, 15), v(28, 11, 12), v(28, 12, 1), 1},
+    {v(28, 12, 15), v(28, 12, 1), v(28, 12, 2), 14},
+    {v(28, 14, 10), v(28, 13, 16), v(28, 14, 1), 1},
+    {v(28, 14, 10), v(28, 14, 1), v(28, 14, 2), 9},
+    {v(29, 4, 1), v(29, 2, 28), v(29, 3, 1), 5}, // Joel
+    {v(29, 4, 1), v(29, 3, 1), v(29, 4, 1), 21},
+    {v(32, 2, 11), v(32, 1, 17), v(32, 2, 1), 1}, // Jonah
+    {v(32, 2, 11), v(32, 2, 1), v(32, 2, 2), 10},
+    {v(33, 4, 14), v(33, 5, 1), v(33, 4, 14), 1}, // Micah
+    {v(33, 4, 14), v(33, 5, 2), v(33, 5, 1), 14},
+    {v(34, 2, 14), v(34, 1, 15), v(34, 2, 1), 1}, // Nahum
+    {v(34, 2, 14), v(34, 2, 1), v(34, 2, 2), 13},
+    {v(38, 2, 17), v(38, 1, 18), v(38, 2, 1), 4}, // Zechariah
+    {v(38, 2, 17), v(38, 2, 1), v(38, 2, 5), 13},
+    {v(39, 3, 19), v(39, 4, 1), v(39, 3, 19), 6}, // Malachi
+};
+} // namespace
+
+VerseAlignment VerseAlignment::build(const BibleStore &store) {
+  VerseAlignment alignment;
+  for (const Shift &shift : kHebrewShifts) {
+    if (store.find(shift.marker) < 0)
+      continue;
+    // Verse numbers stay within one chapter, so ids step by one
+    for (int k = 0; k < shift.count; ++k) {
+      alignment.m_toLocal.push_back({shift.shared + k, shift.local + k});
+      if (!shift.partial)
+        alignment.m_toShared.push_back({shift.local + k, shift.shared + k});
+    }
+  }
+  std::sort(alignment.m_toLocal.begin(), alignment.m_toLocal.end());
+  std::sort(alignment.m_toShared.begin(), alignment.m_toShared.end());
+  return alignment;
+}
+
+VerseId VerseAlignment::lookup(const Table &table, VerseId id) {
+  auto it = std::lower_bound(
+      table.begin(), table.end(), id,
+      [](const std::pair<VerseId, VerseId> &entry, VerseId key) {
+        return entry.first < key;
+      });
+  return it != table.end() && it->first == id ? it->second : id;
+}
+} // namespace Bible
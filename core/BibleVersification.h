@@ -0,0 +1,46 @@
+#pragma once
+#include "BibleStore.h"
+#include <utility>
+#include <vector>
+
+namespace Bible {
+// Maps the verses of one version to shared verse ids, so the same verse can
+// be found in every version whatever its numbering there.
+//
+// Shared ids follow the English numbering, which most versions use as is.
+// Versions numbered like the Hebrew text (Malachi 3:19-24 for 4:1-6, Joel
+// with four chapters, and so on) are recognized at load by verses only that
+// numbering has; for those, the shifted ranges are kept in two small sorted
+// tables. Every other verse's shared id is its own id.
+class VerseAlignment {
+public:
+  static VerseAlignment build(const BibleStore &store);
+
+  // Whether the version numbers every verse by its shared id
+  bool isIdentity() const { return m_toLocal.empty(); }
+
+  // Index in store of the verse with a shared id, or -1 if it has none
+  int find(const BibleStore &store, VerseId shared) const {
+    return store.find(isIdentity() ? shared : localId(shared));
+  }
+  // Shared id of verse i of store
+  VerseId sharedId(const BibleStore &store, int i) const {
+    const VerseId id = store.verseId(i);
+    return isIdentity() ? id : lookup(m_toShared, id);
+  }
+  VerseId localId(VerseId shared) const { return lookup(m_toLocal, shared); }
+
+  qint64 memoryBytes() const {
+    return qint64((m_toLocal.capacity() + m_toShared.capacity()) *
+                  sizeof(Table::value_type));
+  }
+
+private:
+  using Table = std::vector<std::pair<VerseId, VerseId>>; // Sorted by first
+
+  static VerseId lookup(const Table &table, VerseId id);
+
+  Table m_toLocal;
+  Table m_toShared;
+};
+} // namespace Bible
@@ -0,0 +1,567 @@
+#include "BibleXml.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void appendUtf8(QByteArray &out, char32_t c) {
+  if (c < 0x80) {
+    out += char(c);
+  } else if (c < 0x800) {
+    out += char(0xc0 | (c >> 6));
+    out += char(0x80 | (c & 0x3f));
+  } else if (c < 0x10000) {
+    out += char(0xe0 | (c >> 12));
+    out += char(0x80 | ((c >> 6) & 0x3f));
+    out += char(0x80 | (c & 0x3f));
+  } else {
+    out += char(0xf0 | (c >> 18));
+    out += char(0x80 | ((c >> 12) & 0x3f));
+    out += char(0x80 | ((c >> 6) & 0x3f));
+    out += char(0x80 | (c & 0x3f));
+  }
+}
+
+// Character an entity reference stands for, given its name ("amp", "#233",
+// "#xe9"), or 0 if it is not a predefined entity or a valid character
+char32_t entityValue(QByteArrayView name) {
+  if (name == "amp")
+    return '&';
+  if (name == "lt")
+    return '<';
+  if (name == "gt")
+    return '>';
+  if (name == "quot")
+    return '"';
+  if (name == "apos")
+    return '\'';
+  if (name.size() < 2 || name[0] != '#')
+    return 0;
+  const bool hex = name[1] == 'x';
+  qsizetype i = hex ? 2 : 1;
+  if (i == name.size())
+    return 0;
+  char32_t value = 0;
+  for (; i < name.size(); ++i) {
+    const char c = name[i];
+    int digit;
+    if (c >= '0' && c <= '9')
+      digit = c - '0';
+    else if (hex && c >= 'a' && c <= 'f')
+      digit = c - 'a' + 10;
+    else if (hex && c >= 'A' && c <= 'F')
+      digit = c - 'A' + 10;
+    else
+      return 0;
+    value = value * (hex ? 16 : 10) + char32_t(digit);
+    if (value > 0x10ffff)
+      return 0;
+  }
+  if (value >= 0xd800 && value <= 0xdfff)
+    return 0;
+  return value;
+}
+
+// Like QString::toInt() on an attribute value: 0 unless it is a number
+int toNumber(QByteArrayView value) {
+  qsizetype i = 0;
+  qsizetype end = value.size();
+  while (i < end && isSpace(value[i]))
+    ++i;
+  while (end > i && isSpace(value[end - 1]))
+    --end;
+  bool negative = false;
+  if (i < end && (value[i] == '+' || value[i] == '-'))
+    negative = value[i++] == '-';
+  if (i == end || end - i > 9)
+    return 0;
+  int number = 0;
+  for (; i < end; ++i) {
+    if (value[i] < '0' || value[i] > '9')
+      return 0;
+    number = number * 10 + (value[i] - '0');
+  }
+  return negative ? -number : number;
+}
+
+// Appends text with "\r\n" and lone '\r' turned into '\n'
+void appendNormalized(QByteArray &out, const char *p, const char *end) {
+  while (p < end) {
+    const char *cr =
+        static_cast<const char *>(std::memchr(p, '\r', size_t(end - p)));
+    if (!cr) {
+      out.append(p, end - p);
+      return;
+    }
+    out.append(p, cr - p);
+    out += '\n';
+    p = cr + 1 < end && cr[1] == '\n' ? cr + 2 : cr + 1;
+  }
+}
+
+// Whether the byte after a '<' can start markup; otherwise the '<' is a
+// stray character of the text
+bool startsMarkup(char c) {
+  return c == '/' || c == '!' || c == '?' || c == '_' || c == ':' ||
+         (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || uchar(c) >= 0x80;
+}
+
+QByteArrayView trimmed(QByteArrayView text) {
+  qsizetype first = 0;
+  qsizetype last = text.size();
+  while (first < last && isSpace(text[first]))
+    ++first;
+  while (last > first && isSpace(text[last - 1]))
+    --last;
+  return text.sliced(first, last - first);
+}
+
+QString tagName(QByteArrayView name) {
+  return "<" + QString::fromUtf8(name.data(), name.size()) + ">";
+}
+} // namespace
+
+BibleXmlReader::BibleXmlReader(QByteArrayView source)
+    : m_begin(source.data()), m_end(source.data() + source.size()) {
+  if (source.startsWith("\xef\xbb\xbf"))
+    m_pos = 3; // Byte order mark
+}
+
+BibleXmlReader::Token BibleXmlReader::readNext() {
+  if (atEnd())
+    return m_token;
+  const qsizetype size = m_end - m_begin;
+  while (true) {
+    // Character data outside verses is skipped; after the root element only
+    // whitespace should follow
+    const auto *lt = static_cast<const char *>(
+        std::memchr(m_begin + m_pos, '<', size_t(size - m_pos)));
+    const qsizetype next = lt ? lt - m_begin : size;
+    if (m_rootClosed) {
+      for (qsizetype i = m_pos; i < next; ++i) {
+        if (!isSpace(m_begin[i])) {
+          recover(i, "Text after the root element ignored");
+          break;
+        }
+      }
+    }
+    m_pos = next;
+    if (!lt) {
+      closeFrom(0, size, "the end of the document");
+      return m_token = EndDocument;
+    }
+    if (m_pos + 1 == size || !startsMarkup(m_begin[m_pos + 1])) {
+      recover(m_pos, "Stray '<' ignored");
+      ++m_pos;
+      continue;
+    }
+
+    bool ok = true;
+    if (skipSpecial(ok)) {
+      if (!ok)
+        return m_token;
+      continue;
+    }
+    const qsizetype at = m_pos;
+    Tag tag;
+    if (!readTag(tag))
+      return m_token;
+    if (tag.end) {
+      closeElement(tag.name, at);
+      continue;
+    }
+    if (m_rootClosed) {
+      recover(at, "Element after the root element read");
+      m_rootClosed = false;
+    }
+
+    int number = 0;
+    const Token kind = kindOf(tag, number);
+    if (kind == Verse) {
+      m_number = number;
+      m_text = QByteArrayView();
+      m_textNeedsDecoding = false;
+      if (!tag.empty && !readVerseText())
+        return m_token;
+      return m_token = Verse;
+    }
+    // A book ends any book or chapter still open, a chapter any chapter
+    if (kind == Book || kind == Chapter) {
+      for (size_t i = 0; i < m_open.size(); ++i) {
+        if (m_open[i].kind == Chapter ||
+            (kind == Book && m_open[i].kind == Book)) {
+          closeFrom(i, at, tagName(tag.name));
+          break;
+        }
+      }
+    }
+    if (!tag.empty)
+      m_open.push_back({tag.name, kind});
+    else if (m_open.empty())
+      m_rootClosed = true; // An empty root element
+    if (kind == Book) {
+      // <b n=Genesis> has an unquoted name; <Mwanzo n=1> is named by its tag
+      m_n = tag.name == "b" ? tag.n : tag.name;
+      return m_token = Book;
+    }
+    if (kind == Chapter) {
+      m_number = number;
+      return m_token = Chapter;
+    }
+  }
+}
+
+QString BibleXmlReader::bookName() const {
+  QByteArray name;
+  appendText(name, m_n);
+  // Attribute values have their whitespace normalized to spaces
+  for (char &c : name) {
+    if (c == '\n' || c == '\t')
+      c = ' ';
+  }
+  return QString::fromUtf8(name);
+}
+
+bool BibleXmlReader::readTag(Tag &tag) {
+  const char *s = m_begin;
+  const qsizetype size = m_end - m_begin;
+  const qsizetype at = m_pos;
+  qsizetype i = m_pos + 1;
+  if (i < size && s[i] == '/') {
+    tag.end = true;
+    ++i;
+  }
+  const qsizetype nameStart = i;
+  while (i < size && !isSpace(s[i]) && s[i] != '>' && s[i] != '/')
+    ++i;
+  tag.name = QByteArrayView(s + nameStart, i - nameStart);
+  qsizetype nameEnd = -1; // Where the n attribute starts
+  bool words = false;      // Of a name with spaces
+
+  while (true) {
+    while (i < size && isSpace(s[i]))
+      ++i;
+    if (i == size) {
+      fail("Unterminated tag", at);
+      return false;
+    }
+    if (s[i] == '>') {
+      ++i;
+      break;
+    }
+    if (s[i] == '/' && !tag.end && i + 1 < size && s[i + 1] == '>') {
+      tag.empty = true;
+      i += 2;
+      break;
+    }
+    if (tag.end) {
+      // "</Ufunuo wa Yohana>": the name is all of it
+      const auto *close = static_cast<const char *>(
+          std::memchr(s + i, '>', size_t(size - i)));
+      if (!close) {
+        fail("Unterminated tag", at);
+        return false;
+      }
+      tag.name = trimmed(QByteArrayView(s + nameStart, close - s - nameStart));
+      i = close - s + 1;
+      break;
+    }
+
+    const qsizetype attributeStart = i;
+    while (i < size && !isSpace(s[i]) && s[i] != '=' && s[i] != '>' &&
+           s[i] != '/')
+      ++i;
+    const QByteArrayView attribute(s + attributeStart, i - attributeStart);
+    while (i < size && isSpace(s[i]))
+      ++i;
+    if (attribute.isEmpty() || i == size || s[i] != '=') {
+      // A word of a legacy name ("<Mambo ya Nyakati n=13>") or a stray '/'
+      tag.legacy = words = true;
+      if (attribute.isEmpty() && i < size && s[i] == '/')
+        ++i;
+      continue;
+    }
+    ++i;
+    while (i < size && isSpace(s[i]))
+      ++i;
+    if (i == size) {
+      fail("Unterminated tag", at);
+      return false;
+    }
+    QByteArrayView value;
+    if (s[i] == '"' || s[i] == '\'') {
+      const qsizetype valueStart = i + 1;
+      const auto *close = static_cast<const char *>(
+          std::memchr(s + valueStart, s[i], size_t(size - valueStart)));
+      if (!close) {
+        fail("Unterminated attribute value", i);
+        return false;
+      }
+      value = QByteArrayView(s + valueStart, close - s - valueStart);
+      i = close - s + 1;
+    } else {
+      const qsizetype valueStart = i;
+      while (i < size && !isSpace(s[i]) && s[i] != '>' &&
+             !(s[i] == '/' && i + 1 < size && s[i + 1] == '>'))
+        ++i;
+      value = QByteArrayView(s + valueStart, i - valueStart);
+      tag.legacy = true;
+      ++m_legacyMarkup;
+    }
+    if (attribute == "n") {
+      tag.n = value;
+      nameEnd = attributeStart;
+    }
+  }
+  if (words && !tag.end) {
+    const qsizetype end = nameEnd >= 0 ? nameEnd : i - (tag.empty ? 2 : 1);
+    tag.name = trimmed(QByteArrayView(s + nameStart, end - nameStart));
+  }
+  if (tag.name.isEmpty())
+    recover(at, "Tag without a name ignored");
+  m_pos = i;
+  return true;
+}
+
+BibleXmlReader::Token BibleXmlReader::kindOf(const Tag &tag, int &number) {
+  if (tag.name == "v" || tag.name == "c") {
+    number = toNumber(tag.n);
+    return tag.name == "v" ? Verse : Chapter;
+  }
+  if (tag.name == "b")
+    return Book;
+  // Legacy chapters are named by their number, legacy books have words
+  // where XML has attributes; neither is well-formed XML
+  if (!tag.legacy && tag.n.isEmpty() && !tag.name.isEmpty() &&
+      tag.name[0] >= '0' && tag.name[0] <= '9') {
+    number = toNumber(tag.name);
+    if (number > 0) {
+      ++m_legacyMarkup;
+      return Chapter;
+    }
+  }
+  if (tag.legacy && !tag.n.isEmpty() && !tag.name.isEmpty()) {
+    ++m_legacyMarkup;
+    return Book;
+  }
+  return NoToken;
+}
+
+bool BibleXmlReader::skipSpecial(bool &ok) {
+  const QByteArrayView rest(m_begin + m_pos, m_end - m_begin - m_pos);
+  auto skipPast = [&](QByteArrayView close, const char *message) {
+    const qsizetype at = rest.indexOf(close, 2);
+    if (at < 0) {
+      ok = false;
+      fail(message, m_pos);
+    } else {
+      m_pos += at + close.size();
+    }
+    return true;
+  };
+  if (rest.startsWith("<!--"))
+    return skipPast("-->", "Unterminated comment");
+  if (rest.startsWith("<![CDATA["))
+    return skipPast("]]>", "Unterminated CDATA section");
+  if (rest.startsWith("<?"))
+    return skipPast("?>", "Unterminated processing instruction");
+  if (rest.startsWith("<!")) {
+    // DOCTYPE, whose internal subset may hold '>' between brackets
+    int depth = 0;
+    for (qsizetype i = 2; i < rest.size(); ++i) {
+      if (rest[i] == '[') {
+        ++depth;
+      } else if (rest[i] == ']') {
+        --depth;
+      } else if (rest[i] == '>' && depth <= 0) {
+        m_pos += i + 1;
+        return true;
+      }
+    }
+    ok = false;
+    fail("Unterminated declaration", m_pos);
+    return true;
+  }
+  return false;
+}
+
+bool BibleXmlReader::readVerseText() {
+  const char *s = m_begin;
+  const qsizetype size = m_end - m_begin;
+  const qsizetype start = m_pos;
+  const size_t depth = m_open.size();
+  bool markup = false; // Anything but plain text and the end tag
+  // Ends the verse at offset; markup there is read again by readNext()
+  auto endBefore = [&](qsizetype offset, const QString &cause) {
+    recover(offset, "Unclosed <v> closed by " + cause);
+    closeFrom(depth, offset, cause);
+    m_text = QByteArrayView(s + start, offset - start);
+    m_pos = offset;
+  };
+  while (true) {
+    const auto *lt = static_cast<const char *>(
+        std::memchr(s + m_pos, '<', size_t(size - m_pos)));
+    if (!lt) {
+      endBefore(size, "the end of the document");
+      break;
+    }
+    m_pos = lt - s;
+    if (m_pos + 1 == size || !startsMarkup(s[m_pos + 1])) {
+      recover(m_pos, "Stray '<' kept as text");
+      markup = true;
+      ++m_pos;
+      continue;
+    }
+    bool ok = true;
+    if (skipSpecial(ok)) {
+      if (!ok)
+        return false;
+      markup = true;
+      continue;
+    }
+    const qsizetype at = m_pos;
+    Tag tag;
+    if (!readTag(tag))
+      return false;
+
+    if (tag.end) {
+      auto open = [&](size_t first, size_t last) {
+        for (size_t i = last; i > first; --i) {
+          if (m_open[i - 1].name == tag.name)
+            return true;
+        }
+        return false;
+      };
+      if (tag.name == "v" && !open(depth, m_open.size())) {
+        closeFrom(depth, at, "</v>");
+        m_text = QByteArrayView(s + start, at - start);
+        break;
+      }
+      if (!open(depth, m_open.size()) && open(0, depth)) {
+        endBefore(at, "</" + QString::fromUtf8(tag.name.data(),
+                                               tag.name.size()) + ">");
+        break;
+      }
+      // A child element of the verse, or a stray end tag
+      closeElement(tag.name, at, depth);
+      markup = true;
+      continue;
+    }
+    int number = 0;
+    if (kindOf(tag, number) != NoToken) {
+      endBefore(at, tagName(tag.name));
+      break;
+    }
+    // A child element: its text counts, its tags do not
+    markup = true;
+    if (!tag.empty)
+      m_open.push_back({tag.name, NoToken});
+  }
+  m_textNeedsDecoding =
+      markup ||
+      std::memchr(m_text.data(), '&', size_t(m_text.size())) != nullptr ||
+      std::memchr(m_text.data(), '\r', size_t(m_text.size())) != nullptr;
+  return true;
+}
+
+void BibleXmlReader::closeFrom(size_t index, qsizetype offset,
+                               const QString &cause) {
+  for (size_t i = m_open.size(); i > index; --i)
+    recover(offset, "Unclosed " + tagName(m_open[i - 1].name) +
+                        " closed by " + cause);
+  if (index < m_open.size())
+    m_open.resize(index);
+}
+
+void BibleXmlReader::closeElement(QByteArrayView name, qsizetype offset,
+                                  size_t first) {
+  const QString tag = "</" + QString::fromUtf8(name.data(), name.size()) + ">";
+  for (size_t i = m_open.size(); i > first; --i) {
+    if (m_open[i - 1].name == name) {
+      closeFrom(i, offset, tag);
+      m_open.pop_back();
+      m_rootClosed = m_open.empty();
+      return;
+    }
+  }
+  recover(offset, "Stray " + tag + " ignored");
+}
+
+void BibleXmlReader::recover(qsizetype offset, const QString &message) {
+  m_recoveries.push_back({offset, message});
+}
+
+BibleXmlReader::Token BibleXmlReader::fail(const char *message,
+                                           qsizetype offset) {
+  if (m_token != Invalid) {
+    m_error = QString::fromLatin1(message);
+    m_errorOffset = offset;
+    m_token = Invalid;
+  }
+  return m_token;
+}
+
+void BibleXmlReader::appendText(QByteArray &out, QByteArrayView raw) {
+  const char *p = raw.data();
+  const char *end = p + raw.size();
+  auto skipPast = [&](QByteArrayView close) {
+    const qsizetype at = QByteArrayView(p, end - p).indexOf(close);
+    return at < 0 ? end : p + at + close.size();
+  };
+  while (p < end) {
+    const char c = *p;
+    if (c == '&') {
+      // Entity names are short; "&#x10ffff;" is the longest we know
+      const qsizetype span = std::min<qsizetype>(end - p - 1, 10);
+      const auto *semi =
+          static_cast<const char *>(std::memchr(p + 1, ';', size_t(span)));
+      const char32_t value =
+          semi ? entityValue(QByteArrayView(p + 1, semi - p - 1)) : 0;
+      if (value) {
+        appendUtf8(out, value);
+        p = semi + 1;
+      } else {
+        out += '&'; // Not an entity we know; kept as written
+        ++p;
+      }
+    } else if (c == '<') {
+      const QByteArrayView rest(p, end - p);
+      if (rest.size() == 1 || !startsMarkup(rest[1])) {
+        out += '<'; // A stray '<' of the text
+        ++p;
+      } else if (rest.startsWith("<![CDATA[")) {
+        const char *text = p + 9;
+        p = skipPast("]]>");
+        appendNormalized(out, text, p == end ? end : p - 3);
+      } else if (rest.startsWith("<!--")) {
+        p = skipPast("-->");
+      } else if (rest.startsWith("<?")) {
+        p = skipPast("?>");
+      } else {
+        // A tag; '>' may appear inside a quoted attribute value
+        char quote = 0;
+        for (++p; p < end; ++p) {
+          if (quote) {
+            if (*p == quote)
+              quote = 0;
+          } else if (*p == '"' || *p == '\'') {
+            quote = *p;
+          } else if (*p == '>') {
+            ++p;
+            break;
+          }
+        }
+      }
+    } else {
+      const char *q = p;
+      while (q < end && *q != '&' && *q != '<')
+        ++q;
+      appendNormalized(out, p, q);
+      p = q;
+    }
+  }
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <vector>
+
+// Pull parser for the Bible XML schema
+//   <bible><b n="Genesis"><c n="1"><v n="1">text</v>...</c></b></bible>
+// that works on the UTF-8 bytes of the document in place, typically a
+// memory-mapped file.
+//
+// Unlike QXmlStreamReader it allocates nothing per element: a verse's text
+// is a view of the source, and only needs decoding (see appendText) when it
+// holds entities, CDATA, comments, child elements or carriage returns.
+// Elements other than b, c and v are skipped, as are comments, processing
+// instructions and the DOCTYPE.
+//
+// Malformed documents are read in the same single pass rather than
+// rejected. Unclosed and misnested elements are closed where the schema
+// says they must end (a verse at the next verse, chapter or book, a chapter
+// at the next chapter or book, and so on), stray end tags are dropped, and
+// each such repair is recorded in recoveries(). Tags of the legacy export
+// format, <Mwanzo n=1> for a book and <1> for a chapter, are read as <b>
+// and <c>, and attribute values may be unquoted.
+class BibleXmlReader {
+public:
+  enum Token { NoToken, Book, Chapter, Verse, EndDocument, Invalid };
+
+  explicit BibleXmlReader(QByteArrayView source);
+
+  Token readNext();
+  bool atEnd() const { return m_token == EndDocument || m_token == Invalid; }
+
+  // Book: its n attribute, decoded
+  QString bookName() const;
+  // Chapter and Verse: their n attribute, 0 if it is missing or not a number
+  int number() const { return m_number; }
+  // Verse: its raw content, between the start and the end tag
+  QByteArrayView text() const { return m_text; }
+  // Whether text() must go through appendText() rather than be copied
+  bool textNeedsDecoding() const { return m_textNeedsDecoding; }
+
+  // Appends the character data of raw element content: entities decoded,
+  // CDATA unwrapped, comments and tags of child elements dropped, and line
+  // ends normalized to '\n'
+  static void appendText(QByteArray &out, QByteArrayView raw);
+
+  // A markup error read past
+  struct Recovery {
+    qsizetype offset; // Of the markup in the source, in bytes
+    QString message;
+  };
+  const std::vector<Recovery> &recoveries() const { return m_recoveries; }
+  // Legacy tags and unquoted attribute values read so far
+  int legacyMarkup() const { return m_legacyMarkup; }
+
+  // Only markup that cannot be read past (a tag, comment or the like still
+  // open at the end of the document) stops the reader with an error
+  bool hasError() const { return m_token == Invalid; }
+  QString errorString() const { return m_error; }
+  // Byte offset in the source where the error was found
+  qsizetype errorOffset() const { return m_errorOffset; }
+
+private:
+  struct Tag {
+    QByteArrayView name;
+    QByteArrayView n; // Raw value of the n attribute
+    bool end = false;
+    bool empty = false;  // Self-closing
+    // Legacy syntax: unquoted values, or a name of several words running up
+    // to the n attribute
+    bool legacy = false;
+  };
+  // An open element; kind is Book, Chapter or NoToken for any other
+  struct Element {
+    QByteArrayView name;
+    Token kind;
+  };
+
+  // Parses the tag starting at the '<' at m_pos and moves past it. Returns
+  // false, with the error set, if it is not terminated.
+  bool readTag(Tag &tag);
+  // Book, Chapter, Verse or NoToken for a start tag; sets number for a
+  // chapter given in the legacy form
+  Token kindOf(const Tag &tag, int &number);
+  // Skips a comment, CDATA section, processing instruction or DOCTYPE
+  // starting at m_pos; false if it is not one. ok is cleared, with the error
+  // set, if it is one but is not terminated.
+  bool skipSpecial(bool &ok);
+  // Reads the content of the verse whose start tag was just read, up to its
+  // end tag or to the markup that ends it
+  bool readVerseText();
+  // Closes the open elements from index on, recording why
+  void closeFrom(size_t index, qsizetype offset, const QString &cause);
+  // Closes the element an end tag names, or drops the tag if none is open
+  // from index first on
+  void closeElement(QByteArrayView name, qsizetype offset, size_t first = 0);
+  void recover(qsizetype offset, const QString &message);
+  // Stops the reader with an error; returns Invalid
+  Token fail(const char *message, qsizetype offset);
+
+  const char *m_begin;
+  const char *m_end;
+  qsizetype m_pos = 0;
+  std::vector<Element> m_open;
+  bool m_rootClosed = false;
+
+  Token m_token = NoToken;
+  QByteArrayView m_n;
+  int m_number = 0;
+  QByteArrayView m_text;
+  bool m_textNeedsDecoding = false;
+  std::vector<Recovery> m_recoveries;
+  int m_legacyMarkup = 0;
+  QString m_error;
+  qsizetype m_errorOffset = -1;
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <QtGlobal>
+#include <list>
+#include <map>
+#include <utility>
+
+// Map of at most capacity entries that drops the least recently used one to
+// make room for a new one, and counts how often lookups find what they ask
+// for. Not thread-safe.
+template <typename Key, typename Value> class LruCache {
+public:
+  explicit LruCache(size_t capacity) : m_capacity(capacity) {}
+
+  // The value of key, now the most recently used, or nullptr. Counts a hit
+  // or a miss.
+  Value *find(const Key &key) {
+    auto it = m_index.find(key);
+    if (it == m_index.end()) {
+      ++m_misses;
+      return nullptr;
+    }
+    ++m_hits;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return &it->second->second;
+  }
+
+  // Sets the value of key, dropping the least recently used entry if the
+  // cache is full
+  void insert(const Key &key, Value value) {
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+      it->second->second = std::move(value);
+      m_entries.splice(m_entries.begin(), m_entries, it->second);
+      return;
+    }
+    if (m_entries.size() >= m_capacity && !m_entries.empty()) {
+      m_index.erase(m_entries.back().first);
+      m_entries.pop_back();
+    }
+    m_entries.emplace_front(key, std::move(value));
+    m_index.emplace(key, m_entries.begin());
+  }
+
+  // Drops the entries for which drop(key, value) is true
+  template <typename Predicate> void removeIf(Predicate drop) {
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+      if (drop(it->first, it->second)) {
+        m_index.erase(it->first);
+        it = m_entries.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  size_t size() const { return m_entries.size(); }
+  quint64 hits() const { return m_hits; }
+  quint64 misses() const { return m_misses; }
+
+private:
+  using Entries = std::list<std::pair<Key, Value>>; // Most recent first
+
+  size_t m_capacity;
+  Entries m_entries;
+  std::map<Key, typename Entries::iterator> m_index;
+  quint64 m_hits = 0;
+  quint64 m_misses = 0;
+};
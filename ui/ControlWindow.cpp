@@ -14,6 +14,7 @@
 #include <QMenu>
 #include <QMessageBox>
 #include <QScreen>
+#include <QScrollBar>
 #include <QShortcut>
 #include <QStackedLayout>
 #include <QStandardItemModel>
@@ -194,9 +195,9 @@ private:
 
 VerseWidget::VerseWidget(const QString &book, int chapter, int verse,
                          const QString &text, const QString &version,
-                         QWidget *parent)
+                         VerseId sharedId, QWidget *parent)
     : QWidget(parent), m_book(book), m_chapter(chapter), m_verse(verse),
-      m_currentVersion(version) {
+      m_currentVersion(version), m_text(text), m_sharedId(sharedId) {
   auto *layout = new QVBoxLayout(this);
   layout->setContentsMargins(10, 8, 10, 8);
   layout->setSpacing(8);
@@ -208,6 +209,12 @@ VerseWidget::VerseWidget(const QString &book, int chapter, int verse,
       "selection-background-color: #38bdf8;");
   layout->addWidget(contentLabel);
 
+  missingLabel = new QLabel();
+  missingLabel->setStyleSheet(
+      "color: #f59e0b; font-size: 11px; background: transparent;");
+  missingLabel->hide();
+  layout->addWidget(missingLabel);
+
   // No stretch here to keep verses compact
 
   setAttribute(Qt::WA_StyledBackground, true);
@@ -216,6 +223,44 @@ VerseWidget::VerseWidget(const QString &book, int chapter, int verse,
       "VerseWidget:hover { background: rgba(255,255,255,0.03); }");
 }
 
+QString VerseWidget::reference() const {
+  return QString("%1 %2:%3 (%4)")
+      .arg(m_book)
+      .arg(m_chapter)
+      .arg(m_verse)
+      .arg(m_currentVersion);
+}
+
+void VerseWidget::setVerse(const BibleVerse &verse, const QString &book) {
+  m_book = book;
+  m_chapter = verse.chapter;
+  m_verse = verse.verse;
+  m_currentVersion = verse.version;
+  m_text = verse.text;
+  contentLabel->setText(QString("<b>%1</b> %2").arg(m_verse).arg(m_text));
+  missingLabel->hide();
+}
+
+void VerseWidget::setMissingIn(const QString &version) {
+  missingLabel->setText(
+      QString("Not in %1; shown from %2").arg(version, m_currentVersion));
+  missingLabel->show();
+}
+
+void VerseWidget::setHighlights(
+    const std::vector<std::pair<int, int>> &ranges) {
+  QString html;
+  int pos = 0;
+  for (const auto &[start, length] : ranges) {
+    html += m_text.mid(pos, start - pos).toHtmlEscaped();
+    html += "<span style=\"color: #38bdf8;\">" +
+            m_text.mid(start, length).toHtmlEscaped() + "</span>";
+    pos = start + length;
+  }
+  html += m_text.mid(pos).toHtmlEscaped();
+  contentLabel->setText(QString("<b>%1</b> %2").arg(m_verse).arg(html));
+}
+
 ControlWindow::ControlWindow(ProjectionWindow *proj, SongManager *sm,
                              ThemeManager *tm, QWidget *parent)
     : QMainWindow(parent), projection(proj), songManager(sm), themeManager(tm) {
@@ -273,10 +318,35 @@ ControlWindow::ControlWindow(ProjectionWindow *proj, SongManager *sm,
   // Initial Theme Tab Update
   updateThemeTab();
 
-  // Connect Bible loading
+  // Connect Bible loading. Only the current version is loaded up front, in
+  // the background; the others load when first picked, and the least
+  // recently used ones are unloaded again beyond the memory budget.
+  connect(&BibleManager::instance(), &BibleManager::versionLoaded, this,
+          &ControlWindow::onBibleVersionLoaded);
+  connect(&BibleManager::instance(), &BibleManager::loadProgress, this,
+          [this](int finished, int total) {
+            bibleQuickSearch->setPlaceholderText(
+                finished < total ? QString("Loading Bibles (%1/%2)...")
+                                       .arg(finished)
+                                       .arg(total)
+                                 : QString("Quick Search (e.g. John 3:16)"));
+          });
   connect(&BibleManager::instance(), &BibleManager::bibleLoaded, this,
           &ControlWindow::refreshBibleVersions);
-  BibleManager::instance().loadBibles();
+  connect(&BibleManager::instance(), &BibleManager::versionsChanged, this,
+          &ControlWindow::refreshBibleVersions);
+  {
+    QSettings settings("ChurchProjection", "Bible");
+    const qint64 budgetMiB =
+        settings
+            .value("memoryBudgetMiB",
+                   BibleManager::kDefaultMemoryBudget / (1024 * 1024))
+            .toLongLong();
+    BibleManager::instance().setMemoryBudget(budgetMiB * 1024 * 1024);
+  }
+  BibleManager::instance().loadBibles(
+      {currentBibleVersion.isEmpty() ? "NKJV" : currentBibleVersion});
+  refreshBibleVersions();
 
   // Connect Notes version changes
   connect(notesWidget, &NotesWidget::versionChanged, this,
@@ -498,6 +568,18 @@ void ControlWindow::setupBibleTab(QWidget *container) {
       "QListWidget::item { padding: 8px; border-bottom: 1px solid #334155; }");
   connect(bibleVerseList, &QListWidget::itemClicked, this,
           &ControlWindow::onBibleVerseSelected);
+  // Keyword results arrive a page at a time; fetch more at the bottom
+  connect(bibleVerseList->verticalScrollBar(), &QScrollBar::valueChanged, this,
+          [this](int value) {
+            if (!quickSearchCursor ||
+                value < bibleVerseList->verticalScrollBar()->maximum())
+              return;
+            auto more = BibleManager::instance().fetchMore(quickSearchCursor);
+            if (more.empty())
+              quickSearchCursor.reset();
+            else
+              appendQuickSearchResults(more);
+          });
   topLayout->addWidget(bibleVerseList);
 
   bibleSplitter->addWidget(topWidget);
@@ -662,6 +744,9 @@ void ControlWindow::refreshBookGrid() {
   // If empty, BibleManager defaults to English names if passed "" or defaults
   QString version =
       currentBibleVersion.isEmpty() ? "NKJV" : currentBibleVersion;
+  // Worked out when the version loaded, with its own chapter counts
+  const BibleManager::BookList books =
+      BibleManager::instance().getCanonicalBooks(version);
 
   // Helper to create sections
   auto createSection = [&](const QString &title, BibleManager::Testament t) {
@@ -672,9 +757,6 @@ void ControlWindow::refreshBookGrid() {
     int row = 0, col = 0;
     int maxCols = 4; // 4 books per row
 
-    // Pass version to get localized names
-    auto books = BibleManager::instance().getCanonicalBooks(version);
-
     for (const auto &book : books) {
       if (book.testament == t) {
         // book.name is now LOCALIZED if available (e.g. "Mwanzo")
@@ -784,72 +866,48 @@ void ControlWindow::onChapterSelected(int chapter) {
   currentBibleChapter = chapter;
 
   // 1. Load Content in Top Pane
-  // Reuse existing logic but manual call
-  // We need to fetch verses and populate bibleVerseList
-
-  QString query =
-      QString("%1 %2").arg(currentBibleBook).arg(currentBibleChapter);
-  auto results = BibleManager::instance().search(query);
+  // The chapter comes straight from the version's verse table
 
   bibleVerseList->clear();
+  quickSearchCursor.reset();
+  if (quickSearchToken) {
+    // Its results would replace this chapter
+    quickSearchToken->cancel();
+    quickSearchToken.reset();
+  }
   QString version =
       currentBibleVersion.isEmpty() ? "NKJV" : currentBibleVersion;
   if (version.isEmpty())
     version = "NKJV";
 
-  // Re-search with version filter
-  // Re-search with version filter
-  results = BibleManager::instance().search(query, version);
+  BibleManager &bible = BibleManager::instance();
+  const BibleManager::VerseSpan verses = bible.getChapter(
+      bible.getBookId(currentBibleBook, version), currentBibleChapter, version);
 
-  // Normalize current book to match search results (which are normalized)
-  QString normalizedCurrent = BibleManager::normalizeBookName(currentBibleBook);
+  // Get localized book name for display
+  const QString displayBook =
+      verses.empty() ? QString()
+                     : bible.getLocalizedBookName(verses[0].book(), version);
 
-  for (const auto &v : results) {
-    if (v.chapter == currentBibleChapter && v.book == normalizedCurrent) {
-      QListWidgetItem *item = new QListWidgetItem();
-
-      // Get localized book name for display
-      QString displayBook =
-          BibleManager::instance().getLocalizedBookName(v.book, v.version);
-
-      auto *widget =
-          new VerseWidget(displayBook, v.chapter, v.verse, v.text, v.version);
-
-      item->setData(Qt::UserRole, v.text);
-      QString ref = QString("%1 %2:%3 (%4)")
-                        .arg(displayBook)
-                        .arg(v.chapter)
-                        .arg(v.verse)
-                        .arg(v.version);
-      item->setData(Qt::UserRole + 1, ref);
-
-      connect(widget, &VerseWidget::versionChanged,
-              [item, v](const QString &newVer, const QString &newText) {
-                item->setData(Qt::UserRole, newText);
-                QString newDisplayBook =
-                    BibleManager::instance().getLocalizedBookName(v.book,
-                                                                  newVer);
-                QString newRef = QString("%1 %2:%3 (%4)")
-                                     .arg(newDisplayBook) // FIX: Localize
-                                     .arg(v.chapter)
-                                     .arg(v.verse)
-                                     .arg(newVer);
-                item->setData(Qt::UserRole + 1, newRef);
-              });
-
-      connect(widget, &VerseWidget::verseClicked, [this, item]() {
-        bibleVerseList->setCurrentItem(item);
-        onBibleVerseSelected(item);
-      });
+  for (int i = 0; i < verses.size(); ++i) {
+    const BibleVerse v = verses[i].toVerse();
+    QListWidgetItem *item = new QListWidgetItem();
 
-      item->setSizeHint(widget->sizeHint());
-      bibleVerseList->addItem(item);
-      bibleVerseList->setItemWidget(item, widget);
-    }
+    auto *widget = new VerseWidget(displayBook, v.chapter, v.verse, v.text,
+                                   v.version, v.sharedId);
+
+    connect(widget, &VerseWidget::verseClicked, [this, item]() {
+      bibleVerseList->setCurrentItem(item);
+      onBibleVerseSelected(item);
+    });
+
+    item->setSizeHint(widget->sizeHint());
+    bibleVerseList->addItem(item);
+    bibleVerseList->setItemWidget(item, widget);
   }
 
   // 2. Switch to Verse Grid
-  populateVerseGrid(chapter);
+  populateVerseGrid(verses.size());
   bibleNavStack->setCurrentWidget(verseGridPage);
   navHeaderLabel->setText(QString("%1 %2 > Select Verse")
                               .arg(currentBibleBook)
@@ -857,7 +915,7 @@ void ControlWindow::onChapterSelected(int chapter) {
   updateBibleNavButtons();
 }
 
-void ControlWindow::populateVerseGrid(int chapter) {
+void ControlWindow::populateVerseGrid(int count) {
   QLayoutItem *child;
   while ((child = verseGridLayout->takeAt(0)) != nullptr) {
     if (child->widget())
@@ -865,7 +923,6 @@ void ControlWindow::populateVerseGrid(int chapter) {
     delete child;
   }
 
-  int count = BibleManager::instance().getVerseCount(currentBibleBook, chapter);
   int maxCols = 6;
 
   for (int i = 1; i <= count; ++i) {
@@ -881,9 +938,8 @@ void ControlWindow::populateVerseGrid(int chapter) {
 }
 
 void ControlWindow::onVerseSelected(int verse) {
-  // Match verse number — data at UserRole+1 is a ref string like "Book Ch:V
-  // (Ver)" So we match by row index (verse-1) since verses are 1-indexed and
-  // list is 0-indexed
+  // Match by row index (verse-1) since verses are 1-indexed and list is
+  // 0-indexed
   int targetRow = verse - 1;
   if (targetRow >= 0 && targetRow < bibleVerseList->count()) {
     auto *item = bibleVerseList->item(targetRow);
@@ -1352,21 +1408,59 @@ void ControlWindow::setGlobalBibleVersion(const QString &version) {
     notesWidget->setCurrentVersion(version);
   }
 
-  // Reload current Bible view if applicable
-  if (!currentBibleBook.isEmpty() && currentBibleChapter > 0) {
-    onChapterSelected(currentBibleChapter);
-  }
+  // Picking a version not loaded yet never waits for it: the list and the
+  // book grid follow once it loads (see onBibleVersionLoaded)
+  if (BibleManager::instance().isVersionLoaded(version))
+    showListedVersesIn(version);
+  else
+    BibleManager::instance().requestVersion(version);
+  // Further pages of a quick search would come in the old version; one
+  // still running is started again in the new one
+  quickSearchCursor.reset();
+  if (quickSearchToken)
+    onQuickSearch();
 
   emit bibleVersionChanged(version);
 }
 
+void ControlWindow::showListedVersesIn(const QString &version) {
+  // One lookup each by shared verse id, without searching again. Verses the
+  // version lacks stay in their own version, marked as such.
+  BibleManager &bible = BibleManager::instance();
+  std::vector<QListWidgetItem *> items;
+  std::vector<VerseId> ids;
+  for (int row = 0; row < bibleVerseList->count(); ++row) {
+    QListWidgetItem *item = bibleVerseList->item(row);
+    if (auto *widget =
+            qobject_cast<VerseWidget *>(bibleVerseList->itemWidget(item))) {
+      items.push_back(item);
+      ids.push_back(widget->sharedId());
+    }
+  }
+  const std::vector<BibleVerse> verses = bible.getVerses(ids, version);
+  for (size_t i = 0; i < items.size(); ++i) {
+    auto *widget =
+        static_cast<VerseWidget *>(bibleVerseList->itemWidget(items[i]));
+    if (verses[i].text.isEmpty())
+      widget->setMissingIn(version);
+    else
+      widget->setVerse(verses[i],
+                       bible.getLocalizedBookName(verses[i].book, version));
+    items[i]->setSizeHint(widget->sizeHint());
+  }
+}
+
 // Obsolete methods removed
 
 void ControlWindow::onBibleVerseSelected(QListWidgetItem *item) {
-  if (!item)
+  // The widget holds the verse; items carry no copy of it
+  auto *widget = item ? qobject_cast<VerseWidget *>(
+                            bibleVerseList->itemWidget(item))
+                      : nullptr;
+  if (!widget)
     return;
-  QString text = item->data(Qt::UserRole).toString();
-  QString ref = item->data(Qt::UserRole + 1).toString();
+  const QString &text = widget->text();
+  QString ref = widget->reference();
 
   QString fullText;
   if (!ref.isEmpty()) {
@@ -1384,11 +1478,24 @@ void ControlWindow::onQuickSearch() {
 
   QString version =
       currentBibleVersion.isEmpty() ? "NKJV" : currentBibleVersion;
-  auto results = BibleManager::instance().search(query, version);
-  if (results.empty())
-    return;
+  quickSearchToken = BibleManager::instance().searchAsync(
+      query, version, this, [this](const BibleManager::SearchBatch &batch) {
+        if (batch.last)
+          quickSearchToken.reset();
+        if (batch.first) {
+          if (batch.last && batch.verses.empty())
+            return; // Nothing found; keep what is shown
+          bibleVerseList->clear();
+          quickSearchCursor.reset();
+        }
+        appendQuickSearchResults(batch.verses);
+        if (batch.last)
+          quickSearchCursor = batch.cursor;
+      });
+}
 
-  bibleVerseList->clear();
+void ControlWindow::appendQuickSearchResults(
+    const std::vector<BibleVerse> &results) {
   for (const auto &v : results) {
     QListWidgetItem *item = new QListWidgetItem();
 
@@ -1396,29 +1503,10 @@ void ControlWindow::onQuickSearch() {
     QString displayBook =
         BibleManager::instance().getLocalizedBookName(v.book, v.version);
 
-    auto *widget =
-        new VerseWidget(displayBook, v.chapter, v.verse, v.text, v.version);
-
-    item->setData(Qt::UserRole, v.text);
-    QString ref = QString("%1 %2:%3 (%4)")
-                      .arg(displayBook)
-                      .arg(v.chapter)
-                      .arg(v.verse)
-                      .arg(v.version);
-    item->setData(Qt::UserRole + 1, ref);
-
-    connect(widget, &VerseWidget::versionChanged,
-            [item, v](const QString &newVer, const QString &newText) {
-              item->setData(Qt::UserRole, newText);
-              QString newDisplayBook =
-                  BibleManager::instance().getLocalizedBookName(v.book, newVer);
-              QString newRef = QString("%1 %2:%3 (%4)")
-                                   .arg(newDisplayBook) // FIX: Localize
-                                   .arg(v.chapter)
-                                   .arg(v.verse)
-                                   .arg(newVer);
-              item->setData(Qt::UserRole + 1, newRef);
-            });
+    auto *widget = new VerseWidget(displayBook, v.chapter, v.verse, v.text,
+                                   v.version, v.sharedId);
+    if (!v.matches.empty())
+      widget->setHighlights(v.matches);
 
     connect(widget, &VerseWidget::verseClicked, [this, item]() {
       bibleVerseList->setCurrentItem(item);
@@ -1874,6 +1962,19 @@ void ControlWindow::onNotesProject(const QString &text) {
   projectBibleVerse(text); // Reuse
 }
 
+void ControlWindow::onBibleVersionLoaded(const QString &version) {
+  refreshBibleVersions();
+
+  // Localized book names become available with the version itself, and the
+  // listed verses can switch to it if it was picked while loading
+  QString current =
+      currentBibleVersion.isEmpty() ? "NKJV" : currentBibleVersion;
+  if (version == current) {
+    refreshBookGrid();
+    showListedVersesIn(version);
+  }
+}
+
 void ControlWindow::refreshBibleVersions() {
   if (!bibleVersionButtons || !bibleVersionLayout)
     return;
@@ -1895,10 +1996,12 @@ void ControlWindow::refreshBibleVersions() {
     }
   }
 
-  // Reload versions
-  QStringList versions = BibleManager::instance().getVersions();
-  if (currentBibleVersion.isEmpty())
-    currentBibleVersion = "NKJV";
+  // Reload versions. Versions not loaded yet load when picked.
+  QStringList versions = BibleManager::instance().getKnownVersions();
+  // The default, or a version whose file is gone, gives way to one on disk
+  if (!versions.isEmpty() && !versions.contains(currentBibleVersion))
+    setGlobalBibleVersion(versions.contains("NKJV") ? "NKJV"
+                                                    : versions.first());
 
   for (const QString &ver : versions) {
     auto *btn = new QPushButton(ver);
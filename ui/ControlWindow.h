@@ -1,4 +1,5 @@
 #pragma once
+#include "../core/BibleManager.h"
 #include "../core/PdfRenderer.h"
 #include "../core/SongManager.h"
 #include "../core/ThemeManager.h"
@@ -34,10 +35,23 @@ class VerseWidget : public QWidget {
   Q_OBJECT
 public:
   VerseWidget(const QString &book, int chapter, int verse, const QString &text,
-              const QString &version, QWidget *parent = nullptr);
+              const QString &version, VerseId sharedId,
+              QWidget *parent = nullptr);
+
+  // Emphasizes [start, length) ranges of the verse text (search hits)
+  void setHighlights(const std::vector<std::pair<int, int>> &ranges);
+
+  const QString &text() const { return m_text; }
+  // "Mwanzo 1:1 (SWAB)", shown under a projected verse
+  QString reference() const;
+  // Same verse in every version (see BibleManager::getVerses)
+  VerseId sharedId() const { return m_sharedId; }
+  // Shows the verse as given in another version
+  void setVerse(const BibleVerse &verse, const QString &book);
+  // Notes that a version has no such verse, so it is still shown in its own
+  void setMissingIn(const QString &version);
 
 signals:
-  void versionChanged(const QString &newVersion, const QString &newText);
   void verseClicked();
 
 private:
@@ -45,7 +59,10 @@ private:
   int m_chapter;
   int m_verse;
   QString m_currentVersion;
+  QString m_text;
+  VerseId m_sharedId;
   QLabel *contentLabel;
+  QLabel *missingLabel;
 };
 
 class ControlWindow : public QMainWindow {
@@ -99,6 +116,7 @@ private slots:
   void onNotesProject(const QString &text);
   void setGlobalBibleVersion(const QString &version);
   void refreshBibleVersions();
+  void onBibleVersionLoaded(const QString &version);
 
 signals:
   void bibleVersionChanged(const QString &version);
@@ -126,6 +144,11 @@ private:
   QButtonGroup *bibleVersionButtons;
   QHBoxLayout *bibleVersionLayout;
   QString currentBibleVersion;
+  // Keyword hits of the last quick search not shown yet
+  std::shared_ptr<BibleManager::SearchCursor> quickSearchCursor;
+  // Quick search still running in the background, if any
+  std::shared_ptr<BibleManager::SearchToken> quickSearchToken;
+  void appendQuickSearchResults(const std::vector<BibleVerse> &results);
 
   // Grid Navigation
   QStackedWidget *bibleNavStack;
@@ -219,8 +242,10 @@ private:
   void setupChapterGrid(QWidget *page);
   void setupVerseGrid(QWidget *page);
   void refreshBookGrid();
+  // Switches the listed verses to a loaded version
+  void showListedVersesIn(const QString &version);
   void populateChapterGrid(const QString &book);
-  void populateVerseGrid(int chapter);
+  void populateVerseGrid(int count);
 
   // State
   int currentSongIndex = -1;
@@ -1,20 +1,85 @@
 #include "NotesWidget.h"
 #include "../core/BibleManager.h"
+#include "../core/BibleReference.h"
 #include <QButtonGroup>
 #include <QComboBox>
+#include <QCoreApplication>
 #include <QDebug>
 #include <QFrame>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QPointer>
 #include <QPushButton>
 #include <QSplitter>
 #include <QTextBlock>
+#include <QTextDocument>
+#include <QThreadPool>
 #include <QVBoxLayout>
+#include <algorithm>
+
+namespace {
+// Pause in typing before edited paragraphs are scanned for references
+constexpr int kScanDelayMs = 300;
+// Verses listed for one reference; "Ps 119" fits
+constexpr int kMaxShownVerses = 200;
+
+struct NotesReference {
+  int start; // In the paragraph
+  int length;
+  std::vector<Bible::VerseRange> ranges;
+};
+
+// What the last scan of a paragraph found
+class ReferenceData : public QTextBlockUserData {
+public:
+  QString text; // Of the paragraph when it was scanned
+  std::vector<NotesReference> references;
+};
+
+// A paragraph on its way through a background scan
+struct ScannedParagraph {
+  int block; // Number
+  QString text;
+  std::vector<NotesReference> references;
+};
+
+bool needsScan(const QTextBlock &block) {
+  auto *data = static_cast<ReferenceData *>(block.userData());
+  return !data || data->text != block.text();
+}
+} // namespace
 
 NotesWidget::NotesWidget(QWidget *parent) : QWidget(parent) {
   setupUI();
+  searchTimer = new QTimer(this);
+  searchTimer->setSingleShot(true);
+  searchTimer->setInterval(120);
+  connect(searchTimer, &QTimer::timeout, this,
+          [this]() { performSearch(pendingQuery); });
+  scanTimer = new QTimer(this);
+  scanTimer->setSingleShot(true);
+  scanTimer->setInterval(kScanDelayMs);
+  connect(scanTimer, &QTimer::timeout, this, &NotesWidget::scanReferences);
+  connect(editor->document(), &QTextDocument::contentsChange, this,
+          &NotesWidget::onContentsChange);
+  connect(editor, &QTextEdit::cursorPositionChanged, this,
+          &NotesWidget::onCursorPositionChanged);
+  connect(&BibleManager::instance(), &BibleManager::versionLoaded, this,
+          &NotesWidget::refreshVersions);
   connect(&BibleManager::instance(), &BibleManager::bibleLoaded, this,
           &NotesWidget::refreshVersions);
+  connect(&BibleManager::instance(), &BibleManager::versionsChanged, this,
+          &NotesWidget::refreshVersions);
+  // An '@' search made before its version loaded went through the other
+  // versions, and a reference shown then had no verses yet
+  connect(&BibleManager::instance(), &BibleManager::versionLoaded, this,
+          [this](const QString &version) {
+            if (version != currentVersion())
+              return;
+            if (!pendingQuery.isEmpty() && queryAtCursor() == pendingQuery)
+              performSearch(pendingQuery);
+            refreshShownReference();
+          });
   // Initial refresh in case already loaded
   refreshVersions();
 }
@@ -32,6 +97,16 @@ void NotesWidget::setCurrentVersion(const QString &version) {
   }
   // Trigger search refresh with new version
   onTextChanged();
+  refreshShownReference();
+}
+
+QString NotesWidget::currentVersion() const {
+  if (versionButtonGroup) {
+    if (auto *checkedBtn =
+            qobject_cast<QPushButton *>(versionButtonGroup->checkedButton()))
+      return checkedBtn->text();
+  }
+  return "NKJV"; // Default
 }
 
 void NotesWidget::setupUI() {
@@ -71,7 +146,8 @@ void NotesWidget::setupUI() {
   editor = new QTextEdit();
   editor->setPlaceholderText(
       "Type your notes here...\n\nUse @ to search for scriptures (e.g., @John "
-      "3:16 or @love). Results will appear on the right.");
+      "3:16 or @love). Results will appear on the right. References in your "
+      "notes are underlined; put the cursor on one to see its verses.");
   editor->setStyleSheet(
       "QTextEdit { background: rgba(30, 41, 59, 0.6); border: 1px solid "
       "rgba(148, 163, 184, 0.2); border-radius: 8px; color: white; padding: "
@@ -120,7 +196,7 @@ void NotesWidget::setupUI() {
   connect(editor, &QTextEdit::textChanged, this, &NotesWidget::onTextChanged);
 }
 
-void NotesWidget::onTextChanged() {
+QString NotesWidget::queryAtCursor() const {
   QString text = editor->toPlainText();
   QTextCursor cursor = editor->textCursor();
   int pos = cursor.position();
@@ -131,48 +207,227 @@ void NotesWidget::onTextChanged() {
   if (atIndex != -1) {
     QString query = text.mid(atIndex + 1, pos - atIndex - 1);
     // Only trigger if query length is sufficient
-    if (query.length() >= 2) {
-      performSearch(query);
-      return;
-    }
+    if (query.length() >= 2)
+      return query;
+  }
+  return QString();
+}
+
+void NotesWidget::onTextChanged() {
+  const QString query = queryAtCursor();
+  if (!query.isEmpty()) {
+    pendingQuery = query;
+    searchTimer->start();
+    return;
   }
-  // Optional: Clear results if '@' sequence is broken?
-  // deciding to keep them for persistence as requested
+  // No '@' query any more: drop the pending search, keep the results shown
+  searchTimer->stop();
 }
 
 void NotesWidget::performSearch(const QString &query) {
-  // Get selected version from button group
-  QString version = "NKJV"; // Default
-  if (versionButtonGroup) {
-    auto *checkedBtn =
-        qobject_cast<QPushButton *>(versionButtonGroup->checkedButton());
-    if (checkedBtn) {
-      version = checkedBtn->text();
+  const QString version = currentVersion();
+
+  // Runs in the background; a newer search cancels this one, so only the
+  // latest query's batches reach the list
+  BibleManager::instance().searchAsync(
+      query, version, this,
+      [this, version](const BibleManager::SearchBatch &batch) {
+        if (batch.first) {
+          resultsList->clear();
+          shownReference = {-1, QString(), -1};
+        }
+        for (const auto &verse : batch.verses)
+          addVerseItem(verse, version);
+      },
+      &searchSession);
+}
+
+void NotesWidget::addVerseItem(const BibleVerse &verse,
+                               const QString &version) {
+  // Localize book name
+  QString displayBook =
+      BibleManager::instance().getLocalizedBookName(verse.book, version);
+
+  QString label = QString("%1 %2:%3\n%4")
+                      .arg(displayBook)
+                      .arg(verse.chapter)
+                      .arg(verse.verse)
+                      .arg(verse.text);
+
+  QListWidgetItem *item = new QListWidgetItem(label);
+  // Store text to project
+  item->setData(Qt::UserRole, verse.text);
+  item->setData(Qt::UserRole + 1, QString("%1 %2:%3")
+                                      .arg(displayBook)
+                                      .arg(verse.chapter)
+                                      .arg(verse.verse));
+  resultsList->addItem(item);
+}
+
+void NotesWidget::onContentsChange(int position, int charsRemoved,
+                                   int charsAdded) {
+  // Carry the range still to scan over the edit, then add what it touched
+  auto shift = [&](int pos) {
+    return pos <= position
+               ? pos
+               : std::max(position, pos + charsAdded - charsRemoved);
+  };
+  if (scanFrom < 0) {
+    scanFrom = position;
+    scanTo = position + charsAdded;
+  } else {
+    scanFrom = std::min(shift(scanFrom), position);
+    scanTo = std::max(shift(scanTo), position + charsAdded);
+  }
+  scanTimer->start();
+}
+
+void NotesWidget::refreshShownReference() {
+  shownReference = {-1, QString(), -1};
+  onCursorPositionChanged();
+}
+
+void NotesWidget::scanReferences() {
+  if (scanning)
+    return; // Runs again when the current scan is done
+  QTextDocument *document = editor->document();
+  QTextBlock block = document->begin();
+  QTextBlock last = document->lastBlock();
+  if (!scanAll) {
+    if (scanFrom < 0)
+      return;
+    const int end = document->characterCount() - 1;
+    block = document->findBlock(std::min(scanFrom, end));
+    last = document->findBlock(std::min(scanTo, end));
+  }
+  scanFrom = scanTo = -1;
+  scanAll = false;
+
+  std::vector<ScannedParagraph> paragraphs;
+  for (; block.isValid(); block = block.next()) {
+    if (needsScan(block))
+      paragraphs.push_back({block.blockNumber(), block.text(), {}});
+    if (block == last)
+      break;
+  }
+  if (paragraphs.empty())
+    return;
+
+  // Only the ranges are kept: the verses are looked up when shown, in the
+  // version selected then, which is requested as soon as a scan finds any
+  scanning = true;
+  QPointer<NotesWidget> guard(this);
+  auto scan = [guard, paragraphs = std::move(paragraphs)]() mutable {
+    std::vector<Bible::FoundReference> found;
+    for (ScannedParagraph &paragraph : paragraphs) {
+      found.clear();
+      Bible::findReferences(paragraph.text, found);
+      for (Bible::FoundReference &reference : found)
+        paragraph.references.push_back({int(reference.start),
+                                        int(reference.length),
+                                        std::move(reference.ranges)});
+    }
+
+    // The widget may be gone by then; the guard is only read on its thread
+    QMetaObject::invokeMethod(
+        QCoreApplication::instance(),
+        [guard, paragraphs = std::move(paragraphs)]() mutable {
+          if (!guard)
+            return;
+          NotesWidget *self = guard;
+          self->scanning = false;
+          QTextDocument *document = self->editor->document();
+          bool found = false;
+          for (ScannedParagraph &paragraph : paragraphs) {
+            QTextBlock block = document->findBlockByNumber(paragraph.block);
+            if (!block.isValid() || block.text() != paragraph.text) {
+              // Edited or moved by an edit above it meanwhile
+              self->scanAll = true;
+              continue;
+            }
+            auto *data = new ReferenceData;
+            data->text = paragraph.text;
+            data->references = std::move(paragraph.references);
+            found = found || !data->references.empty();
+            block.setUserData(data); // Deletes the previous one
+          }
+          // Loads the version now, so the verses are ready to show and
+          // project when the cursor gets to a reference
+          if (found)
+            BibleManager::instance().requestVersion(self->currentVersion());
+          self->markReferences();
+          self->onCursorPositionChanged();
+          if (self->scanAll || self->scanFrom >= 0)
+            self->scanTimer->start();
+        },
+        Qt::QueuedConnection);
+  };
+  QThreadPool::globalInstance()->start(std::move(scan));
+}
+
+void NotesWidget::markReferences() {
+  QTextCharFormat format;
+  format.setUnderlineStyle(QTextCharFormat::DotLine);
+  format.setUnderlineColor(QColor("#38bdf8"));
+  QList<QTextEdit::ExtraSelection> selections;
+  for (QTextBlock block = editor->document()->begin(); block.isValid();
+       block = block.next()) {
+    auto *data = static_cast<ReferenceData *>(block.userData());
+    if (!data || data->text != block.text())
+      continue; // Offsets from before an edit; marked after the next scan
+    for (const NotesReference &reference : data->references) {
+      QTextEdit::ExtraSelection selection;
+      selection.cursor = QTextCursor(block);
+      selection.cursor.setPosition(block.position() + reference.start);
+      selection.cursor.setPosition(
+          block.position() + reference.start + reference.length,
+          QTextCursor::KeepAnchor);
+      selection.format = format;
+      selections.append(selection);
     }
   }
+  editor->setExtraSelections(selections);
+}
 
-  auto results = BibleManager::instance().search(query, version);
-
-  resultsList->clear();
-  for (const auto &verse : results) {
-    // Localize book name
-    QString displayBook =
-        BibleManager::instance().getLocalizedBookName(verse.book, version);
-
-    QString label = QString("%1 %2:%3\n%4")
-                        .arg(displayBook)
-                        .arg(verse.chapter)
-                        .arg(verse.verse)
-                        .arg(verse.text);
-
-    QListWidgetItem *item = new QListWidgetItem(label);
-    // Store text to project
-    item->setData(Qt::UserRole, verse.text);
-    item->setData(Qt::UserRole + 1, QString("%1 %2:%3")
-                                        .arg(displayBook)
-                                        .arg(verse.chapter)
-                                        .arg(verse.verse));
-    resultsList->addItem(item);
+void NotesWidget::onCursorPositionChanged() {
+  // Moving away from the '@' query being typed drops its pending search
+  if (searchTimer->isActive() && queryAtCursor() != pendingQuery)
+    searchTimer->stop();
+
+  const QTextCursor cursor = editor->textCursor();
+  const QTextBlock block = cursor.block();
+  auto *data = static_cast<ReferenceData *>(block.userData());
+  if (!data || data->text != block.text())
+    return; // Not scanned since it was edited
+  const int offset = cursor.positionInBlock();
+  for (const NotesReference &reference : data->references) {
+    if (offset < reference.start ||
+        offset > reference.start + reference.length)
+      continue;
+    const std::tuple<int, QString, int> shown{block.blockNumber(), data->text,
+                                              reference.start};
+    if (shown == shownReference)
+      return;
+    // Table lookups of the version: a version not loaded yet is requested,
+    // and versionLoaded shows its verses
+    BibleManager &bible = BibleManager::instance();
+    const QString version = currentVersion();
+    std::vector<BibleManager::VerseSpan> spans;
+    for (const Bible::VerseRange &range : reference.ranges) {
+      BibleManager::VerseSpan span = bible.getRange(range, version);
+      if (!span.empty())
+        spans.push_back(std::move(span));
+    }
+    if (spans.empty())
+      return;
+    shownReference = shown;
+    resultsList->clear();
+    int count = 0;
+    for (const BibleManager::VerseSpan &span : spans) {
+      for (int i = 0; i < span.size() && count < kMaxShownVerses; ++i, ++count)
+        addVerseItem(span[i].toVerse(), version);
+    }
+    return;
   }
 }
 
@@ -195,6 +450,13 @@ void NotesWidget::refreshVersions() {
   if (!versionButtonGroup || !versionLayout)
     return;
 
+  // Keep the user's selection across refreshes
+  QString currentVersion = "NKJV";
+  if (auto *checkedBtn =
+          qobject_cast<QPushButton *>(versionButtonGroup->checkedButton())) {
+    currentVersion = checkedBtn->text();
+  }
+
   // Clear existing buttons
   QList<QAbstractButton *> buttons = versionButtonGroup->buttons();
   for (auto *btn : buttons) {
@@ -211,9 +473,11 @@ void NotesWidget::refreshVersions() {
     }
   }
 
-  // Reload versions
-  QStringList versions = BibleManager::instance().getVersions();
-  QString currentVersion = "NKJV";
+  // Reload versions. Versions not loaded yet load when picked.
+  QStringList versions = BibleManager::instance().getKnownVersions();
+  // Like the Bible tab, fall back to a version on disk
+  if (!versions.isEmpty() && !versions.contains(currentVersion))
+    currentVersion = versions.contains("NKJV") ? "NKJV" : versions.first();
 
   for (const QString &ver : versions) {
     auto *btn = new QPushButton(ver);
@@ -236,6 +500,7 @@ void NotesWidget::refreshVersions() {
 
     connect(btn, &QPushButton::clicked, [this, btn]() {
       onTextChanged();
+      refreshShownReference();
       emit versionChanged(btn->text());
     });
 
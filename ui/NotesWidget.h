@@ -1,9 +1,12 @@
 #pragma once
+#include "../core/BibleManager.h"
 #include <QListWidget>
 #include <QMenu>
 #include <QTextEdit>
+#include <QTimer>
 #include <QVBoxLayout>
 #include <QWidget>
+#include <tuple>
 
 class NotesWidget : public QWidget {
   Q_OBJECT
@@ -20,13 +23,43 @@ private slots:
   void onResultClicked(QListWidgetItem *item);
   void onProjectNoteClicked();
   void refreshVersions();
+  void onContentsChange(int position, int charsRemoved, int charsAdded);
+  void onCursorPositionChanged();
 
 private:
   QTextEdit *editor;
   QListWidget *resultsList;
   class QButtonGroup *versionButtonGroup;
   class QHBoxLayout *versionLayout;
+  // Carries the '@' search from one keystroke to the next
+  std::shared_ptr<BibleManager::SearchSession> searchSession;
+  // Waits for a pause in typing before searching
+  QTimer *searchTimer;
+  QString pendingQuery;
 
+  // Scripture references in the notes are found in the background, a few
+  // paragraphs at a time: those edited since the last scan. Each paragraph
+  // keeps the verse ranges found in it as QTextBlockUserData; their verses
+  // are looked up when the cursor enters a reference.
+  QTimer *scanTimer;
+  int scanFrom = -1; // Characters edited since the last scan, or -1
+  int scanTo = -1;
+  bool scanAll = false;
+  bool scanning = false;
+  // Paragraph number, its text and offset of the reference whose verses the
+  // list shows. Not the paragraph's data: a rescan replaces that, and a new
+  // one may get the address of the one deleted.
+  std::tuple<int, QString, int> shownReference{-1, QString(), -1};
+
+  QString currentVersion() const;
+  // The '@' query before the cursor, or empty if there is none
+  QString queryAtCursor() const;
   void performSearch(const QString &query);
+  void addVerseItem(const BibleVerse &verse, const QString &version);
+  void scanReferences();
+  // Lists the verses of the reference at the cursor again, e.g. in another
+  // version
+  void refreshShownReference();
+  void markReferences();
   void setupUI();
 };